@@ -56,6 +56,17 @@ this namespace. This is mostly of importance when switching the mount
 namespace, as this can also change the filesystem and thus how the namespace
 paths are resolved.
 
+# Scheduling Before the Go Runtime Spins Up
+
+Optionally, the CPU affinity, scheduling policy, nice value and I/O priority
+can be set before any namespace switching takes place, so that all threads
+later created by the Go runtime inherit them:
+
+	gons_cpus=0-3,8      # CPU affinity list
+	gons_sched=idle      # scheduling policy: other, batch, or idle
+	gons_nice=10         # nice value
+	gons_ioprio=be:7     # I/O priority: idle, be:level, or rt:level
+
 # Reexec to the Rescue
 
 In case your Go application wants to fork and then restart itself in order to
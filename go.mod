@@ -1,8 +1,9 @@
 module github.com/thediveo/gons
 
-go 1.19
+go 1.20
 
 require (
+	github.com/google/pprof v0.0.0-20230602150820-91b7bce49751
 	github.com/onsi/ginkgo/v2 v2.13.0
 	github.com/onsi/gomega v1.29.0
 	github.com/thediveo/lxkns v0.28.0
@@ -13,7 +14,6 @@ require (
 	github.com/go-logr/logr v1.2.4 // indirect
 	github.com/go-task/slim-sprig v0.0.0-20230315185526-52ccab3ef572 // indirect
 	github.com/google/go-cmp v0.6.0 // indirect
-	github.com/google/pprof v0.0.0-20230602150820-91b7bce49751 // indirect
 	github.com/thediveo/ioctl v0.9.2 // indirect
 	golang.org/x/net v0.17.0 // indirect
 	golang.org/x/sys v0.13.0 // indirect
@@ -43,6 +43,11 @@
 #include <stdarg.h>
 #include <errno.h>
 #include <limits.h>
+#include <sys/resource.h>
+
+/* ioprio_set(2) bits, as there's neither a libc wrapper nor a header. */
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_CLASS_SHIFT 13
 
 /* Describes a specific type of Linux kernel namespace supported by gons. */
 struct ns_t {
@@ -83,6 +88,12 @@ static char *defaultorder =
 char *gonsmsg;
 static unsigned int maxmsgsize;
 
+/*
+ * Set when gonsmsg reports a failure to apply the scheduling settings instead
+ * of a failure to switch namespaces.
+ */
+int gonsschedfailed;
+
 /*
  * Our last-resort error reporting, which the application should later pick up
  * by calling the Go function gons.Status().
@@ -109,6 +120,127 @@ static void logerr(const char *format, ...) {
     va_end(args);
 }
 
+/*
+ * Parses a decimal integer, which must make up the whole string. Returns 0 on
+ * success, -1 otherwise.
+ */
+static int parseint(const char *s, long *value) {
+    char *end;
+    errno = 0;
+    *value = strtol(s, &end, 10);
+    return (end == s || *end || errno) ? -1 : 0;
+}
+
+/*
+ * Parses a CPU list, such as "0-3,8", into the specified CPU set. Returns 0
+ * on success, -1 if the list is malformed.
+ */
+static int parsecpus(const char *list, cpu_set_t *cpus) {
+    CPU_ZERO(cpus);
+    while (*list) {
+        char *end;
+        long from = strtol(list, &end, 10);
+        if (end == list || from < 0) return -1;
+        long to = from;
+        if (*end == '-') {
+            list = end + 1;
+            to = strtol(list, &end, 10);
+            if (end == list || to < from) return -1;
+        }
+        if (to >= CPU_SETSIZE) return -1;
+        for (long cpu = from; cpu <= to; ++cpu) CPU_SET(cpu, cpus);
+        if (*end == ',') {
+            ++end;
+        } else if (*end) {
+            return -1;
+        }
+        list = end;
+    }
+    return 0;
+}
+
+/*
+ * Apply the CPU affinity, scheduling policy, nice value and I/O priority
+ * specified through env variables. As we're still single-threaded, all the
+ * threads the Go runtime later creates will inherit these settings. Returns 0
+ * on success, -1 otherwise.
+ */
+static int gonsched(void) {
+    long value;
+    char *envvar = getenv("gons_cpus");
+    if (envvar && *envvar) {
+        cpu_set_t cpus;
+        if (parsecpus(envvar, &cpus) < 0) {
+            logerr("package gons: invalid gons_cpus list \"%s\"", envvar);
+            return -1;
+        }
+        /* Again, avoid musl's take on things and go for the syscall itself. */
+        if (syscall(SYS_sched_setaffinity, 0, sizeof(cpus), &cpus) < 0) {
+            logerr("package gons: cannot set CPU affinity \"%s\": %s",
+                envvar, strerror(errno));
+            return -1;
+        }
+    }
+    envvar = getenv("gons_sched");
+    if (envvar && *envvar) {
+        int policy;
+        if (!strcmp(envvar, "other")) {
+            policy = SCHED_OTHER;
+        } else if (!strcmp(envvar, "batch")) {
+            policy = SCHED_BATCH;
+        } else if (!strcmp(envvar, "idle")) {
+            policy = SCHED_IDLE;
+        } else {
+            logerr("package gons: invalid gons_sched policy \"%s\"", envvar);
+            return -1;
+        }
+        /* musl's sched_setscheduler() just returns ENOSYS... */
+        struct sched_param param = { .sched_priority = 0 };
+        if (syscall(SYS_sched_setscheduler, 0, policy, &param) < 0) {
+            logerr("package gons: cannot set scheduling policy \"%s\": %s",
+                envvar, strerror(errno));
+            return -1;
+        }
+    }
+    envvar = getenv("gons_nice");
+    if (envvar && *envvar) {
+        if (parseint(envvar, &value) < 0 || value < -20 || value > 19) {
+            logerr("package gons: invalid gons_nice value \"%s\"", envvar);
+            return -1;
+        }
+        if (setpriority(PRIO_PROCESS, 0, (int) value) < 0) {
+            logerr("package gons: cannot set nice value %ld: %s",
+                value, strerror(errno));
+            return -1;
+        }
+    }
+    envvar = getenv("gons_ioprio");
+    if (envvar && *envvar) {
+        /* Either "idle", or "rt:level" or "be:level". */
+        int class = 0;
+        value = 0;
+        if (!strcmp(envvar, "idle")) {
+            class = 3;
+        } else if (!strncmp(envvar, "rt:", 3) || !strncmp(envvar, "be:", 3)) {
+            class = envvar[0] == 'r' ? 1 : 2;
+            if (parseint(envvar + 3, &value) < 0 || value < 0 || value > 7) {
+                class = 0;
+            }
+        }
+        if (!class) {
+            logerr("package gons: invalid gons_ioprio \"%s\"", envvar);
+            return -1;
+        }
+        if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+                    class << IOPRIO_CLASS_SHIFT | (int) value) < 0) {
+            logerr("package gons: cannot set I/O priority \"%s\": %s",
+                envvar, strerror(errno));
+            return -1;
+        }
+    }
+    return 0;
+}
+
 /*
  * Switch into the Linux kernel namespaces specified through env variables:
  * these env vars reference namespaces in the filesystem, such as
@@ -116,6 +248,12 @@ static void logerr(const char *format, ...) {
  * the set of Linux namespaces supported.
  */
 void gonamespaces(void) {
+    // Apply any scheduling settings first: after joining a user namespace we
+    // might have lost the capabilities to, say, raise our priorities.
+    if (gonsched() < 0) {
+        gonsschedfailed = 1;
+        return;
+    }
     // Find out whether we should keep some ooooorder ;) The order describes
     // the sequence in which the namespaces should be entered whether the
     // paths are resolved into fds before the first setns(), or as the setns()
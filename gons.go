@@ -20,6 +20,7 @@ package gons
 /*
 extern void gonamespaces(void);
 extern char *gonsmsg;
+extern int gonsschedfailed;
 void __attribute__((constructor)) init(void) {
 	gonamespaces();
 }
@@ -41,13 +42,35 @@ func (e *NamespaceSwitchError) Error() string {
 	return e.details
 }
 
+// SchedulingError reports unsuccessfully applying the CPU affinity,
+// scheduling policy, nice value or I/O priority during startup, before any
+// namespaces were switched.
+type SchedulingError struct {
+	details string
+}
+
+// Error returns a description of the failure causing the initial scheduling
+// settings to abort.
+func (e *SchedulingError) Error() string {
+	if e == nil {
+		return "<nil>"
+	}
+	return e.details
+}
+
 // Status returns nil if there were no problems switching namespaces during
 // initial startup; otherwise, it returns a NamespaceSwitchError with a detail
-// description.
+// description, or a SchedulingError if the scheduling settings couldn't be
+// applied in the first place.
 func Status() error {
 	if C.gonsmsg == nil {
 		return nil
 	}
+	if C.gonsschedfailed != 0 {
+		return &SchedulingError{
+			details: C.GoString(C.gonsmsg),
+		}
+	}
 	return &NamespaceSwitchError{
 		details: C.GoString(C.gonsmsg),
 	}
@@ -0,0 +1,231 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"sync"
+	"time"
+)
+
+// Priority of a re-execution when waiting for admission because of the
+// process-wide AdmissionLimits.
+type Priority int
+
+// Re-executions with interactive priority always get admitted before any
+// waiting re-executions with background priority.
+const (
+	InteractivePriority Priority = iota // default priority.
+	BackgroundPriority
+
+	numPriorities = int(BackgroundPriority) + 1
+)
+
+// SpawnPriority specifies the priority of a re-execution when it needs to
+// wait for admission.
+func SpawnPriority(p Priority) ReexecActionOption {
+	if p < InteractivePriority || p > BackgroundPriority {
+		panic("gons/reexec: SpawnPriority: invalid priority")
+	}
+	return func(a *ReexecAction) {
+		a.Priority = p
+	}
+}
+
+// AdmissionLimits limits the spawning of re-executed children process-wide,
+// so that bursts of independent callers don't fork hundreds of children at
+// once. Zero values mean unlimited.
+type AdmissionLimits struct {
+	MaxChildren int     // maximum number of concurrently running children.
+	SpawnRate   float64 // maximum sustained number of spawns per second.
+	SpawnBurst  int     // number of spawns allowed in a burst; at least 1.
+}
+
+// AdmissionStats reports the number of running and waiting children, as well
+// as how long re-executions had to wait for admission, per Priority.
+type AdmissionStats struct {
+	Running      int                          // currently running children.
+	Waiting      [numPriorities]int           // currently waiting re-executions.
+	Admitted     [numPriorities]uint64        // total admitted re-executions.
+	QueueWait    [numPriorities]time.Duration // total time spent waiting for admission.
+	MaxQueueWait [numPriorities]time.Duration // longest time spent waiting for admission.
+}
+
+// SetAdmissionLimits sets the process-wide limits for spawning re-executed
+// children. Already waiting re-executions become subject to the new limits.
+func SetAdmissionLimits(limits AdmissionLimits) {
+	admission.setLimits(limits)
+}
+
+// Admission returns the current process-wide admission statistics.
+func Admission() AdmissionStats {
+	return admission.stats()
+}
+
+// admission is the process-wide admission controller for spawning children.
+var admission = newAdmissionController()
+
+// admissionController admits re-executions subject to a maximum number of
+// running children and a token bucket spawn rate limit. Re-executions not
+// immediately admitted queue up in FIFO order per priority.
+type admissionController struct {
+	mu      sync.Mutex
+	limits  AdmissionLimits
+	tokens  float64   // spawn tokens currently available.
+	refill  time.Time // when tokens were last refilled.
+	timer   *time.Timer
+	waiters [numPriorities][]*admissionWaiter
+	st      AdmissionStats
+	now     func() time.Time // for testing.
+}
+
+// admissionWaiter is a re-execution waiting for admission.
+type admissionWaiter struct {
+	admitted chan struct{}
+	since    time.Time
+}
+
+// newAdmissionController returns a new admission controller without any
+// limits.
+func newAdmissionController() *admissionController {
+	return &admissionController{now: time.Now}
+}
+
+// setLimits sets new limits, admitting waiting re-executions if the new
+// limits allow for it.
+func (c *admissionController) setLimits(limits AdmissionLimits) {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	if limits.SpawnBurst < 1 {
+		limits.SpawnBurst = 1
+	}
+	c.limits = limits
+	c.refill = c.now()
+	c.tokens = float64(limits.SpawnBurst)
+	c.dispatch()
+}
+
+// stats returns a snapshot of the admission statistics.
+func (c *admissionController) stats() AdmissionStats {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	st := c.st
+	for p := range c.waiters {
+		st.Waiting[p] = len(c.waiters[p])
+	}
+	return st
+}
+
+// acquire blocks until a re-execution with the specified priority gets
+// admitted.
+func (c *admissionController) acquire(p Priority) {
+	c.mu.Lock()
+	now := c.now()
+	if c.queued() == 0 && c.available(now) {
+		c.admit(p, 0)
+		c.mu.Unlock()
+		return
+	}
+	w := &admissionWaiter{admitted: make(chan struct{}), since: now}
+	c.waiters[p] = append(c.waiters[p], w)
+	c.dispatch()
+	c.mu.Unlock()
+	<-w.admitted
+}
+
+// release signals that an admitted child has terminated.
+func (c *admissionController) release() {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	c.st.Running--
+	c.dispatch()
+}
+
+// queued returns the number of waiting re-executions; the caller must hold
+// the lock.
+func (c *admissionController) queued() (n int) {
+	for p := range c.waiters {
+		n += len(c.waiters[p])
+	}
+	return
+}
+
+// available refills the spawn tokens and then returns true if another child
+// can be admitted right now; the caller must hold the lock.
+func (c *admissionController) available(now time.Time) bool {
+	if c.limits.MaxChildren > 0 && c.st.Running >= c.limits.MaxChildren {
+		return false
+	}
+	if c.limits.SpawnRate <= 0 {
+		return true
+	}
+	c.tokens += now.Sub(c.refill).Seconds() * c.limits.SpawnRate
+	if burst := float64(c.limits.SpawnBurst); c.tokens > burst {
+		c.tokens = burst
+	}
+	c.refill = now
+	return c.tokens >= 1
+}
+
+// admit accounts for a newly admitted child; the caller must hold the lock.
+func (c *admissionController) admit(p Priority, waited time.Duration) {
+	if c.limits.SpawnRate > 0 {
+		c.tokens--
+	}
+	c.st.Running++
+	c.st.Admitted[p]++
+	c.st.QueueWait[p] += waited
+	if waited > c.st.MaxQueueWait[p] {
+		c.st.MaxQueueWait[p] = waited
+	}
+}
+
+// dispatch admits as many waiting re-executions as the limits allow, highest
+// priority first. If waiters remain only because of the spawn rate, then it
+// arranges for another dispatch as soon as the next spawn token becomes
+// available. The caller must hold the lock.
+func (c *admissionController) dispatch() {
+	now := c.now()
+	for p := range c.waiters {
+		for len(c.waiters[p]) > 0 {
+			if !c.available(now) {
+				c.schedule()
+				return
+			}
+			w := c.waiters[p][0]
+			c.waiters[p][0] = nil
+			c.waiters[p] = c.waiters[p][1:]
+			c.admit(Priority(p), now.Sub(w.since))
+			close(w.admitted)
+		}
+	}
+}
+
+// schedule arranges for a later dispatch when waiting re-executions are
+// blocked only by the spawn rate; re-executions blocked by the maximum number
+// of children get admitted when children terminate. The caller must hold the
+// lock.
+func (c *admissionController) schedule() {
+	if c.timer != nil || c.limits.SpawnRate <= 0 || c.tokens >= 1 ||
+		(c.limits.MaxChildren > 0 && c.st.Running >= c.limits.MaxChildren) {
+		return
+	}
+	wait := time.Duration((1 - c.tokens) / c.limits.SpawnRate * float64(time.Second))
+	c.timer = time.AfterFunc(wait, func() {
+		c.mu.Lock()
+		defer c.mu.Unlock()
+		c.timer = nil
+		c.dispatch()
+	})
+}
@@ -0,0 +1,120 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"sync"
+	"time"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+var _ = Describe("admission control", func() {
+
+	It("rejects invalid priorities", func() {
+		Expect(func() { SpawnPriority(Priority(42)) }).To(Panic())
+		Expect(NewReexecAction("action", SpawnPriority(BackgroundPriority)).Priority).To(
+			Equal(BackgroundPriority))
+	})
+
+	It("limits the number of running children and prioritizes", func() {
+		c := newAdmissionController()
+		c.setLimits(AdmissionLimits{MaxChildren: 1})
+		c.acquire(InteractivePriority)
+		Expect(c.stats().Running).To(Equal(1))
+
+		var mu sync.Mutex
+		var order []Priority
+		var wg sync.WaitGroup
+		start := func(p Priority) {
+			wg.Add(1)
+			go func() {
+				defer wg.Done()
+				c.acquire(p)
+				mu.Lock()
+				order = append(order, p)
+				mu.Unlock()
+				c.release()
+			}()
+		}
+		start(BackgroundPriority)
+		Eventually(func() int { return c.stats().Waiting[BackgroundPriority] }).Should(Equal(1))
+		start(InteractivePriority)
+		Eventually(func() int { return c.stats().Waiting[InteractivePriority] }).Should(Equal(1))
+
+		c.release()
+		wg.Wait()
+		Expect(order).To(Equal([]Priority{InteractivePriority, BackgroundPriority}))
+		st := c.stats()
+		Expect(st.Running).To(BeZero())
+		Expect(st.Admitted).To(Equal([numPriorities]uint64{2, 1}))
+		Expect(st.QueueWait[BackgroundPriority]).NotTo(BeZero())
+		Expect(st.MaxQueueWait[BackgroundPriority]).To(Equal(st.QueueWait[BackgroundPriority]))
+	})
+
+	It("limits the spawn rate", func() {
+		c := newAdmissionController()
+		c.setLimits(AdmissionLimits{SpawnRate: 20, SpawnBurst: 2})
+		start := time.Now()
+		for i := 0; i < 4; i++ {
+			c.acquire(InteractivePriority)
+			c.release()
+		}
+		Expect(time.Since(start)).To(BeNumerically(">=", 90*time.Millisecond))
+		st := c.stats()
+		Expect(st.Admitted[InteractivePriority]).To(Equal(uint64(4)))
+		Expect(st.MaxQueueWait[InteractivePriority]).To(BeNumerically(">=", 40*time.Millisecond))
+	})
+
+	It("admits waiting re-executions when lifting limits", func() {
+		c := newAdmissionController()
+		c.setLimits(AdmissionLimits{MaxChildren: 1})
+		c.acquire(BackgroundPriority)
+		done := make(chan struct{})
+		go func() {
+			defer close(done)
+			c.acquire(BackgroundPriority)
+		}()
+		Eventually(func() int { return c.stats().Waiting[BackgroundPriority] }).Should(Equal(1))
+		c.setLimits(AdmissionLimits{})
+		Eventually(done).Should(BeClosed())
+		Expect(c.stats().Running).To(Equal(2))
+	})
+
+	It("re-executes subject to the process-wide limits", func() {
+		SetAdmissionLimits(AdmissionLimits{MaxChildren: 2})
+		defer SetAdmissionLimits(AdmissionLimits{})
+		before := Admission()
+		var wg sync.WaitGroup
+		for i := 0; i < 4; i++ {
+			wg.Add(1)
+			go func() {
+				defer GinkgoRecover()
+				defer wg.Done()
+				var s string
+				Expect(RunReexecAction("action",
+					SpawnPriority(BackgroundPriority), Result(&s))).To(Succeed())
+				Expect(s).To(Equal("done"))
+			}()
+		}
+		wg.Wait()
+		after := Admission()
+		Expect(after.Running).To(Equal(before.Running))
+		Expect(after.Admitted[BackgroundPriority] - before.Admitted[BackgroundPriority]).To(
+			Equal(uint64(4)))
+	})
+
+})
@@ -0,0 +1,41 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"fmt"
+	"os"
+
+	"github.com/thediveo/gons/reexec/internal/testsupport"
+)
+
+// benchmarkAction is the name of the built-in action running benchmarks
+// registered with gons/reexec/testing.RegisterBenchmark() inside re-executed
+// children.
+const benchmarkAction = "gons/reexec/benchmark"
+
+func init() {
+	testsupport.RunBenchmarkAction = func(namespaces []Namespace, param interface{}, result interface{}) error {
+		return RunReexecAction(benchmarkAction,
+			Namespaces(namespaces), Param(param), Result(result))
+	}
+	Register(benchmarkAction, func() {
+		if testsupport.ServeBenchmark == nil {
+			fmt.Fprint(os.Stderr, "gons/reexec: benchmark action: gons/reexec/testing not in use")
+			return
+		}
+		testsupport.ServeBenchmark()
+	})
+}
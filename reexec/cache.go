@@ -0,0 +1,141 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"bytes"
+	"crypto/sha256"
+	"encoding/hex"
+	"encoding/json"
+	"os"
+	"sync"
+)
+
+// digestEnvVar passes the digest of the result the parent has seen last to
+// the re-executed child. Its mere presence tells Reply() to send a
+// replyHeader first.
+const digestEnvVar = "gons_reexec_digest"
+
+// replyHeader precedes the result sent by Reply() when the parent uses a
+// ResultCache. If the result is unchanged, the header isn't followed by the
+// result.
+type replyHeader struct {
+	Digest    string `json:"gons_reexec_digest"`
+	Unchanged bool   `json:"unchanged,omitempty"`
+}
+
+// replyHeaderPrefix identifies a replyHeader as opposed to some other result.
+var replyHeaderPrefix = []byte(`{"gons_reexec_digest":`)
+
+// ResultCache remembers the digest of the last result of a particular
+// re-executed action, so that the action can skip sending its result when it
+// didn't change since. The parent then skips decoding and instead leaves the
+// Result untouched; thus, the Result must still contain the last result. A
+// ResultCache should be used only for repeated re-executions of the same
+// action with the same parameter and namespaces, and it must not be used by
+// concurrent re-executions.
+//
+// Actions need to send their results using Reply() in order to support
+// result caching.
+type ResultCache struct {
+	mu        sync.Mutex
+	digest    string
+	unchanged bool
+}
+
+// CachedResult specifies a ResultCache for incrementally updating the Result.
+func CachedResult(cache *ResultCache) ReexecActionOption {
+	return func(a *ReexecAction) {
+		a.ResultCache = cache
+	}
+}
+
+// Digest returns the digest of the last result seen, if any.
+func (c *ResultCache) Digest() string {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	return c.digest
+}
+
+// Unchanged returns true if the last re-execution returned an unchanged
+// result.
+func (c *ResultCache) Unchanged() bool {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	return c.unchanged
+}
+
+// update records the outcome of a re-execution.
+func (c *ResultCache) update(digest string, unchanged bool) {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	c.digest, c.unchanged = digest, unchanged
+}
+
+// decode decodes a result that is optionally preceded by a replyHeader. If
+// the header reports the result as unchanged, then the result is left
+// untouched. Results without a header, because the action doesn't use
+// Reply(), are decoded as usual.
+func (c *ResultCache) decode(dec *json.Decoder, result interface{}) error {
+	var raw json.RawMessage
+	if err := dec.Decode(&raw); err != nil {
+		return err
+	}
+	if !bytes.HasPrefix(raw, replyHeaderPrefix) {
+		c.update("", false)
+		return json.Unmarshal(raw, result)
+	}
+	var hdr replyHeader
+	if err := json.Unmarshal(raw, &hdr); err != nil {
+		return err
+	}
+	if hdr.Unchanged && hdr.Digest == c.Digest() {
+		c.update(hdr.Digest, true)
+		return nil
+	}
+	if err := dec.Decode(result); err != nil {
+		return err
+	}
+	c.update(hdr.Digest, false)
+	return nil
+}
+
+// Reply sends the result of an action running in a re-executed child to the
+// parent. If the parent uses a ResultCache and already has the very same
+// result, then Reply only tells the parent that the result is unchanged,
+// instead of sending it again.
+func Reply(result interface{}) error {
+	pe := paramPool.Get().(*paramEncoder)
+	defer putBuffer(&paramPool, &pe.buf, pe)
+	if err := pe.enc.Encode(result); err != nil {
+		return err
+	}
+	lastdigest, cached := os.LookupEnv(digestEnvVar)
+	if !cached {
+		_, err := os.Stdout.Write(pe.buf.Bytes())
+		return err
+	}
+	sum := sha256.Sum256(pe.buf.Bytes())
+	hdr := replyHeader{Digest: hex.EncodeToString(sum[:])}
+	hdr.Unchanged = hdr.Digest == lastdigest
+	if err := json.NewEncoder(os.Stdout).Encode(hdr); err != nil {
+		return err
+	}
+	if hdr.Unchanged {
+		return nil
+	}
+	_, err := os.Stdout.Write(pe.buf.Bytes())
+	return err
+}
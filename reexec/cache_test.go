@@ -0,0 +1,77 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"encoding/json"
+	"fmt"
+	"os"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+func init() {
+	Register("echo", func() {
+		var param string
+		if err := json.NewDecoder(os.Stdin).Decode(&param); err != nil {
+			fmt.Fprint(os.Stderr, err.Error())
+			return
+		}
+		_ = Reply(param)
+	})
+}
+
+var _ = Describe("cached results", func() {
+
+	It("replies without cache", func() {
+		var s string
+		Expect(RunReexecAction("echo", Param("foo"), Result(&s))).To(Succeed())
+		Expect(s).To(Equal("foo"))
+	})
+
+	It("skips unchanged results", func() {
+		cache := &ResultCache{}
+		var s string
+		Expect(RunReexecAction("echo", Param("foo"), CachedResult(cache), Result(&s))).To(Succeed())
+		Expect(s).To(Equal("foo"))
+		Expect(cache.Unchanged()).To(BeFalse())
+		Expect(cache.Digest()).To(HaveLen(64))
+
+		// Mess with the result in order to see that it doesn't get decoded
+		// again.
+		s = "sentinel"
+		Expect(RunReexecAction("echo", Param("foo"), CachedResult(cache), Result(&s))).To(Succeed())
+		Expect(s).To(Equal("sentinel"))
+		Expect(cache.Unchanged()).To(BeTrue())
+
+		digest := cache.Digest()
+		Expect(RunReexecAction("echo", Param("bar"), CachedResult(cache), Result(&s))).To(Succeed())
+		Expect(s).To(Equal("bar"))
+		Expect(cache.Unchanged()).To(BeFalse())
+		Expect(cache.Digest()).NotTo(Equal(digest))
+	})
+
+	It("handles actions not supporting caching", func() {
+		cache := &ResultCache{}
+		cache.update("deadbeef", true)
+		var s string
+		Expect(RunReexecAction("action", CachedResult(cache), Result(&s))).To(Succeed())
+		Expect(s).To(Equal("done"))
+		Expect(cache.Digest()).To(BeEmpty())
+		Expect(cache.Unchanged()).To(BeFalse())
+	})
+
+})
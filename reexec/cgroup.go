@@ -0,0 +1,54 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"fmt"
+	"syscall"
+)
+
+// Cgroup specifies the cgroup v2 directory, such as
+// "/sys/fs/cgroup/discovery.slice", to place the re-executed child into. The
+// child gets cloned directly into this cgroup using clone3(CLONE_INTO_CGROUP),
+// so there is no window in which the child would still compete inside our own
+// cgroup, and no racy migration afterwards either. This requires a Linux
+// kernel 5.7 or later.
+func Cgroup(path string) ReexecActionOption {
+	return func(a *ReexecAction) {
+		a.Cgroup = path
+	}
+}
+
+// cgroupAttr returns the system process attributes to clone the child into
+// the specified cgroup, as well as a function to clean up after the child has
+// been started. If no cgroup has been specified, then it returns nil
+// attributes.
+func cgroupAttr(path string) (*syscall.SysProcAttr, func(), error) {
+	if path == "" {
+		return nil, func() {}, nil
+	}
+	fd, err := syscall.Open(path, syscall.O_RDONLY|syscall.O_DIRECTORY|syscall.O_CLOEXEC, 0)
+	if err != nil {
+		return nil, nil, fmt.Errorf(
+			"gons/reexec: ReexecAction.Run: cannot open cgroup %q, reason: %w",
+			path, err)
+	}
+	return &syscall.SysProcAttr{
+			UseCgroupFD: true,
+			CgroupFD:    fd,
+		}, func() {
+			_ = syscall.Close(fd)
+		}, nil
+}
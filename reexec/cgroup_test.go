@@ -0,0 +1,97 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"bufio"
+	"fmt"
+	"os"
+	"path/filepath"
+	"strings"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+func init() {
+	Register("cgroup", func() {
+		fmt.Fprintf(os.Stdout, "%q\n", unifiedCgroup())
+	})
+}
+
+// unifiedCgroup returns the cgroup v2 path of this process, relative to the
+// cgroup v2 root.
+func unifiedCgroup() string {
+	cgroups, _ := os.ReadFile("/proc/self/cgroup")
+	for _, line := range strings.Split(string(cgroups), "\n") {
+		if strings.HasPrefix(line, "0::") {
+			return line[3:]
+		}
+	}
+	return ""
+}
+
+// unifiedMount returns the mount point of the cgroup v2 hierarchy, if any.
+func unifiedMount() string {
+	f, err := os.Open("/proc/self/mountinfo")
+	if err != nil {
+		return ""
+	}
+	defer f.Close()
+	scanner := bufio.NewScanner(f)
+	for scanner.Scan() {
+		fields := strings.Fields(scanner.Text())
+		for idx, field := range fields {
+			if field == "-" && idx+1 < len(fields) && fields[idx+1] == "cgroup2" {
+				return fields[4]
+			}
+		}
+	}
+	return ""
+}
+
+var _ = Describe("cgroups", func() {
+
+	It("reports missing cgroups", func() {
+		Expect(RunReexecAction("action", Cgroup("/nonexisting"))).To(
+			MatchError(MatchRegexp(`cannot open cgroup "/nonexisting"`)))
+	})
+
+	It("starts the child directly in a cgroup", func() {
+		if os.Geteuid() != 0 {
+			Skip("needs root")
+		}
+		mnt := unifiedMount()
+		if mnt == "" {
+			Skip("needs cgroup v2 hierarchy")
+		}
+		mycgroup := unifiedCgroup()
+		cgroup := filepath.Join(mycgroup, fmt.Sprintf("gons-reexec-%d", os.Getpid()))
+		cgroupdir := filepath.Join(mnt, cgroup)
+		if err := os.Mkdir(cgroupdir, 0755); err != nil {
+			Skip("cannot create cgroup: " + err.Error())
+		}
+		defer os.Remove(cgroupdir)
+
+		var s string
+		Expect(RunReexecAction("cgroup", Cgroup(cgroupdir), Result(&s))).To(Succeed())
+		Expect(s).To(Equal(cgroup))
+		Expect(unifiedCgroup()).To(Equal(mycgroup))
+
+		Expect(RunReexecAction("cgroup", Result(&s))).To(Succeed())
+		Expect(s).To(Equal(mycgroup))
+	})
+
+})
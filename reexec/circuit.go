@@ -0,0 +1,195 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"fmt"
+	"strconv"
+	"strings"
+	"sync"
+	"syscall"
+	"time"
+)
+
+// maxTrackedTargets is the number of failing targets above which a
+// FailureTracker starts forgetting about targets that didn't fail recently.
+const maxTrackedTargets = 1024
+
+// FailureTracker is a circuit breaker for re-executions into namespaces that
+// repeatedly fail, such as the namespaces of containers that are gone or
+// stuck: after Threshold consecutive failures for the same set of namespaces,
+// further re-executions into them fail immediately with a *CircuitOpenError
+// during the Backoff period. Afterwards, only a single re-execution gets let
+// through as a probe, while all others keep failing fast: the probe either
+// closes the circuit on success or reopens it on failure. Should the probe
+// not report back within another Backoff period, the next re-execution
+// becomes the probe.
+//
+// Only failures of the namespaces themselves count: children that cannot be
+// started, that fail to switch into their namespaces (including failed
+// preflight checks), or that have to be killed as they didn't terminate in
+// time. Errors of the action, such as stderr output or undecodable results,
+// count as successes as far as the namespaces are concerned.
+//
+// Targets are identified by the device and inode numbers of their namespaces,
+// where these can be determined in the parent, otherwise by their paths.
+//
+// A FailureTracker can be shared between any number of go routines and
+// ReexecActions.
+type FailureTracker struct {
+	Threshold int           // number of consecutive failures opening the circuit.
+	Backoff   time.Duration // time the circuit stays open.
+
+	mu      sync.Mutex
+	targets map[string]*targetFailures // only targets with failures.
+	now     func() time.Time           // for testing.
+}
+
+// targetFailures keeps the recent failures of a particular target.
+type targetFailures struct {
+	failures  int       // number of consecutive failures.
+	last      time.Time // time of last failure.
+	openUntil time.Time // circuit is open until this point in time.
+	probing   time.Time // a half-open probe is in flight until this point in time.
+}
+
+// NewFailureTracker returns a new FailureTracker opening a target's circuit
+// after the specified number of consecutive failures for the specified
+// backoff duration.
+func NewFailureTracker(threshold int, backoff time.Duration) *FailureTracker {
+	if threshold < 1 {
+		panic("gons/reexec: NewFailureTracker: threshold must be at least 1")
+	}
+	return &FailureTracker{
+		Threshold: threshold,
+		Backoff:   backoff,
+		targets:   map[string]*targetFailures{},
+		now:       time.Now,
+	}
+}
+
+// TrackFailures specifies a FailureTracker to short-circuit re-executions into
+// repeatedly failing namespaces.
+func TrackFailures(ft *FailureTracker) ReexecActionOption {
+	return func(a *ReexecAction) {
+		a.FailureTracker = ft
+	}
+}
+
+// CircuitOpenError reports that a re-execution wasn't even attempted, as its
+// namespaces failed repeatedly before.
+type CircuitOpenError struct {
+	Target     string    // identification of the namespaces.
+	Failures   int       // number of consecutive failures.
+	RetryAfter time.Time // when the next re-execution will be allowed.
+}
+
+// Error returns a description of the open circuit.
+func (e *CircuitOpenError) Error() string {
+	return fmt.Sprintf(
+		"gons/reexec: ReexecAction.Run: circuit open for namespaces %s after %d consecutive failures, retry after %s",
+		e.Target, e.Failures, e.RetryAfter.Format(time.RFC3339Nano))
+}
+
+// admit returns a *CircuitOpenError if the circuit for the specified target
+// is currently open, or half-open with a probe already in flight, otherwise
+// nil.
+func (ft *FailureTracker) admit(target string) error {
+	ft.mu.Lock()
+	defer ft.mu.Unlock()
+	tf, ok := ft.targets[target]
+	if !ok || tf.failures < ft.Threshold {
+		return nil
+	}
+	now := ft.now()
+	retryafter := tf.openUntil
+	if !now.Before(tf.openUntil) {
+		// Half-open: let a single probe through.
+		if !now.Before(tf.probing) {
+			tf.probing = now.Add(ft.Backoff)
+			return nil
+		}
+		retryafter = tf.probing
+	}
+	return &CircuitOpenError{
+		Target:     target,
+		Failures:   tf.failures,
+		RetryAfter: retryafter,
+	}
+}
+
+// record records the outcome of a re-execution into the specified target.
+func (ft *FailureTracker) record(target string, failed bool) {
+	ft.mu.Lock()
+	defer ft.mu.Unlock()
+	if !failed {
+		delete(ft.targets, target)
+		return
+	}
+	now := ft.now()
+	tf, ok := ft.targets[target]
+	if !ok {
+		if len(ft.targets) >= maxTrackedTargets {
+			ft.prune(now)
+		}
+		tf = &targetFailures{}
+		ft.targets[target] = tf
+	}
+	tf.failures++
+	tf.last = now
+	if tf.failures >= ft.Threshold {
+		tf.openUntil = now.Add(ft.Backoff)
+		tf.probing = time.Time{}
+	}
+}
+
+// prune forgets about targets that haven't failed for longer than the backoff
+// period, as during container churn most failing targets will never be seen
+// again. Worst case, a target that we forgot about needs to fail Threshold
+// times again before its circuit opens again.
+func (ft *FailureTracker) prune(now time.Time) {
+	for target, tf := range ft.targets {
+		if now.Sub(tf.last) > ft.Backoff {
+			delete(ft.targets, target)
+		}
+	}
+}
+
+// namespacesTarget returns the identification of the specified namespaces
+// for tracking failures. Namespaces are identified by their device and inode
+// numbers where the parent is able to do so; this is the case for namespace
+// paths resolved in the parent's mount namespace context. Otherwise, the
+// namespace type and path are used instead.
+func namespacesTarget(namespaces []Namespace) string {
+	var target strings.Builder
+	inparent := parentContext()
+	for idx, ns := range namespaces {
+		if idx > 0 {
+			target.WriteByte(',')
+		}
+		typename := strings.TrimPrefix(ns.Type, "!")
+		target.WriteString(typename)
+		target.WriteByte(':')
+		var st syscall.Stat_t
+		if inparent(ns) && syscall.Stat(ns.Path, &st) == nil {
+			target.WriteString(strconv.FormatUint(uint64(st.Dev), 10))
+			target.WriteByte(':')
+			target.WriteString(strconv.FormatUint(uint64(st.Ino), 10))
+			continue
+		}
+		target.WriteString(strconv.Quote(ns.Path))
+	}
+	return target.String()
+}
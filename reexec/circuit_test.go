@@ -0,0 +1,142 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"errors"
+	"time"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+var _ = Describe("failure tracking", func() {
+
+	It("identifies namespaces", func() {
+		Expect(namespacesTarget(nil)).To(BeEmpty())
+		Expect(namespacesTarget([]Namespace{
+			{Type: "!net", Path: "/proc/self/ns/net"},
+			{Type: "mnt", Path: "/proc/self/ns/mnt"},
+			{Type: "ipc", Path: "/proc/self/ns/ipc"},
+			{Type: "uts", Path: "/nonexisting"},
+		})).To(MatchRegexp(`^net:\d+:\d+,mnt:\d+:\d+,ipc:"/proc/self/ns/ipc",uts:"/nonexisting"$`))
+		Expect(namespacesTarget([]Namespace{{Type: "net", Path: "/proc/self/ns/net"}})).To(
+			Equal(namespacesTarget([]Namespace{{Type: "net", Path: "/proc/thread-self/ns/net"}})))
+	})
+
+	It("opens and closes circuits", func() {
+		Expect(func() { NewFailureTracker(0, time.Second) }).To(Panic())
+
+		now := time.Now()
+		ft := NewFailureTracker(2, time.Minute)
+		ft.now = func() time.Time { return now }
+
+		Expect(ft.admit("foo")).To(Succeed())
+		ft.record("foo", true)
+		Expect(ft.admit("foo")).To(Succeed())
+		ft.record("foo", true)
+		err := ft.admit("foo")
+		var circerr *CircuitOpenError
+		Expect(errors.As(err, &circerr)).To(BeTrue())
+		Expect(circerr.Failures).To(Equal(2))
+		Expect(circerr.RetryAfter).To(Equal(now.Add(time.Minute)))
+		Expect(ft.admit("bar")).To(Succeed())
+
+		now = now.Add(time.Minute)
+		Expect(ft.admit("foo")).To(Succeed())
+		ft.record("foo", true)
+		Expect(ft.admit("foo")).NotTo(Succeed())
+
+		// Half-open: only a single probe gets through, unless it fails to
+		// report back in time.
+		now = now.Add(time.Minute)
+		Expect(ft.admit("foo")).To(Succeed())
+		err = ft.admit("foo")
+		Expect(errors.As(err, &circerr)).To(BeTrue())
+		Expect(circerr.RetryAfter).To(Equal(now.Add(time.Minute)))
+		now = now.Add(time.Minute)
+		Expect(ft.admit("foo")).To(Succeed())
+		Expect(ft.admit("foo")).NotTo(Succeed())
+
+		now = now.Add(time.Minute)
+		Expect(ft.admit("foo")).To(Succeed())
+		ft.record("foo", false)
+		Expect(ft.targets).To(BeEmpty())
+	})
+
+	It("forgets about stale targets", func() {
+		now := time.Now()
+		ft := NewFailureTracker(1, time.Second)
+		ft.now = func() time.Time { return now }
+		ft.record("foo", true)
+		now = now.Add(2 * time.Second)
+		ft.prune(now)
+		Expect(ft.targets).To(BeEmpty())
+	})
+
+	It("short-circuits failing re-executions", func() {
+		ft := NewFailureTracker(2, time.Hour)
+		ns := Namespaces([]Namespace{{Type: "net", Path: "/nonexisting"}})
+		for i := 0; i < 2; i++ {
+			err := RunReexecAction("action", ns, TrackFailures(ft))
+			var stderrerr *ChildStderrError
+			Expect(errors.As(err, &stderrerr)).To(BeTrue())
+		}
+		err := RunReexecAction("action", ns, TrackFailures(ft))
+		var circerr *CircuitOpenError
+		Expect(errors.As(err, &circerr)).To(BeTrue())
+		Expect(err).To(MatchError(MatchRegexp(`circuit open for namespaces net:"/nonexisting" after 2 consecutive failures`)))
+
+		var s string
+		Expect(RunReexecAction("action", TrackFailures(ft), Result(&s))).To(Succeed())
+		Expect(s).To(Equal("done"))
+	})
+
+	It("doesn't count action errors as namespace failures", func() {
+		ft := NewFailureTracker(1, time.Hour)
+		for i := 0; i < 2; i++ {
+			var s string
+			err := RunReexecAction("silent", TrackFailures(ft), Result(&s))
+			Expect(err).To(MatchError(MatchRegexp(`cannot decode child result`)))
+			err = RunReexecAction("withparam", TrackFailures(ft), Result(&s))
+			var stderrerr *ChildStderrError
+			Expect(errors.As(err, &stderrerr)).To(BeTrue())
+		}
+		Expect(ft.targets).To(BeEmpty())
+	})
+
+	It("counts failed preflight checks as failures", func() {
+		ft := NewFailureTracker(1, time.Hour)
+		ns := Namespaces([]Namespace{{Type: "net", Path: "/nonexisting"}})
+		var nserr *NamespaceError
+		Expect(errors.As(
+			RunReexecAction("action", ns, Preflight(), TrackFailures(ft)),
+			&nserr)).To(BeTrue())
+		var circerr *CircuitOpenError
+		Expect(errors.As(
+			RunReexecAction("action", ns, Preflight(), TrackFailures(ft)),
+			&circerr)).To(BeTrue())
+	})
+
+	It("counts children not terminating in time as failures", func() {
+		ft := NewFailureTracker(1, time.Hour)
+		var s string
+		Expect(RunReexecAction("sleepy", TrackFailures(ft), Result(&s))).To(Succeed())
+		Expect(s).To(Equal("sleeping"))
+		Expect(RunReexecAction("sleepy", TrackFailures(ft), Result(&s))).To(
+			MatchError(MatchRegexp(`circuit open`)))
+	})
+
+})
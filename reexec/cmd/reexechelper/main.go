@@ -0,0 +1,39 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+Command reexechelper is a slim helper executable serving only the actions
+built into gons/reexec, such as reexec.ReadFile, reexec.Stat and
+reexec.ReadDir. Applications can run it instead of re-executing themselves,
+saving their children from loading the applications' complete executables
+and running all their package init()s:
+
+	go build ./reexec/cmd/reexechelper
+
+and then in the application:
+
+	if helper, err := reexec.LocateHelper("reexechelper"); err == nil {
+	    reexec.SetHelper(helper)
+	}
+
+Applications with their own actions build their own helpers in the same way,
+importing the packages registering their actions.
+*/
+package main
+
+import "github.com/thediveo/gons/reexec"
+
+func main() {
+	reexec.HelperMain()
+}
@@ -0,0 +1,425 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+Command reexecstress hammers gons/reexec with lots of concurrent
+RunReexecAction calls in order to shake out fd, zombie and go routine leaks in
+the re-execution plumbing that only show up at scale.
+
+It first sets up a local "farm" of processes, each one sitting in its own
+fresh network and mount namespaces. Then it fans out the requested number of
+re-executions across these namespaces, with every re-executed child reporting
+back the identities of the namespaces it found itself in, so switching
+failures get caught too. While the fan-out is running, reexecstress reports
+throughput, latency percentiles, open fds, zombie children and go routines in
+regular intervals. Finally, it checks that the fd, zombie and go routine
+counts settle back to their baselines and exits with a non-zero code if they
+don't.
+
+As creating namespaces requires CAP_SYS_ADMIN, reexecstress needs to be run as
+root:
+
+	go build ./reexec/cmd/reexecstress && sudo ./reexecstress -n 10000 -c 500
+*/
+package main
+
+import (
+	"encoding/json"
+	"errors"
+	"flag"
+	"fmt"
+	"io"
+	"os"
+	"os/exec"
+	"runtime"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"syscall"
+	"time"
+
+	"github.com/thediveo/gons/reexec"
+)
+
+// parkEnvVar tells a farm child process to just sit in its new namespaces,
+// keeping them alive, until its stdin gets closed.
+const parkEnvVar = "reexecstress_park"
+
+// nsIDs is the result reported by a re-executed child: the inode numbers of
+// the network and mount namespaces it is attached to.
+type nsIDs struct {
+	Net uint64 `json:"net"`
+	Mnt uint64 `json:"mnt"`
+}
+
+func init() {
+	reexec.Register("nsids", func() {
+		_ = json.NewEncoder(os.Stdout).Encode(nsIDs{
+			Net: nsino("/proc/self/ns/net"),
+			Mnt: nsino("/proc/self/ns/mnt"),
+		})
+	})
+}
+
+// nsino returns the inode number of the namespace referenced by path, or
+// zero if it cannot be determined.
+func nsino(path string) uint64 {
+	var st syscall.Stat_t
+	if err := syscall.Stat(path, &st); err != nil {
+		return 0
+	}
+	return st.Ino
+}
+
+func main() {
+	if os.Getenv(parkEnvVar) != "" {
+		_, _ = io.Copy(io.Discard, os.Stdin)
+		os.Exit(0)
+	}
+	reexec.CheckAction()
+
+	calls := flag.Int("n", 10000, "total number of re-executions")
+	concurrency := flag.Int("c", 500, "number of concurrent re-executions")
+	farmsize := flag.Int("farm", 16, "number of net+mnt namespace pairs to fan out to")
+	interval := flag.Duration("interval", time.Second, "reporting interval")
+	settle := flag.Duration("settle", 5*time.Second, "max. time for leak counters to settle after the run")
+	flag.Parse()
+	if *calls <= 0 || *concurrency <= 0 || *farmsize <= 0 {
+		fmt.Fprintln(os.Stderr, "reexecstress: -n, -c and -farm must be positive")
+		os.Exit(2)
+	}
+
+	farm, err := newFarm(*farmsize)
+	if err != nil {
+		fmt.Fprintf(os.Stderr, "reexecstress: cannot create namespace farm: %s\n", err)
+		os.Exit(1)
+	}
+	defer farm.Close()
+
+	// Take the baselines only after the farm has been set up, as the farm
+	// itself accounts for some fds and go routines. And we do a first
+	// re-execution to warm up any lazily initialized state in reexec, such
+	// as the shared /dev/null for the children's stdin.
+	if _, err := farm.run(0); err != nil {
+		fmt.Fprintf(os.Stderr, "reexecstress: warm-up re-execution failed: %s\n", err)
+		farm.Close()
+		os.Exit(1)
+	}
+	base := sample()
+	fmt.Printf("baseline: fds=%d zombies=%d goroutines=%d\n",
+		base.fds, base.zombies, base.goroutines)
+
+	st := &stats{}
+	stop := make(chan struct{})
+	reported := make(chan struct{})
+	go st.report(*interval, stop, reported)
+
+	start := time.Now()
+	var next int64 = -1
+	var wg sync.WaitGroup
+	for w := 0; w < *concurrency; w++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for {
+				n := atomic.AddInt64(&next, 1)
+				if n >= int64(*calls) {
+					return
+				}
+				st.record(farm.run(int(n % int64(len(farm.members)))))
+			}
+		}()
+	}
+	wg.Wait()
+	elapsed := time.Since(start)
+	close(stop)
+	<-reported
+
+	all := st.all()
+	fmt.Printf("\ntotal: %d calls, %d errors in %s, %.1f calls/s\n",
+		len(all), st.errors(), elapsed.Round(time.Millisecond),
+		float64(len(all))/elapsed.Seconds())
+	fmt.Printf("latency: %s\n", percentiles(all))
+	if err := st.firstError(); err != nil {
+		fmt.Printf("first error: %s\n", err)
+	}
+
+	// Give the leak counters some time to settle back to their baselines, as
+	// some go routines and children might still be winding down.
+	leaked := true
+	var final snapshot
+	for deadline := time.Now().Add(*settle); ; {
+		final = sample()
+		if final.fds <= base.fds && final.zombies <= base.zombies &&
+			final.goroutines <= base.goroutines {
+			leaked = false
+			break
+		}
+		if time.Now().After(deadline) {
+			break
+		}
+		time.Sleep(100 * time.Millisecond)
+	}
+	fmt.Printf("final: fds=%d zombies=%d goroutines=%d\n",
+		final.fds, final.zombies, final.goroutines)
+	if leaked {
+		fmt.Println("LEAK: fd, zombie or go routine counts did not settle back to baseline")
+		farm.Close()
+		os.Exit(1)
+	}
+	if st.errors() > 0 {
+		farm.Close()
+		os.Exit(1)
+	}
+}
+
+// farm keeps a set of parked child processes alive, each of them in its own
+// newly created network and mount namespaces.
+type farm struct {
+	members []farmMember
+}
+
+// farmMember is a single parked process together with the identities of its
+// namespaces.
+type farmMember struct {
+	cmd        *exec.Cmd
+	stdin      io.Closer
+	namespaces []reexec.Namespace
+	ids        nsIDs
+}
+
+// newFarm creates a farm of the specified size.
+func newFarm(size int) (f *farm, err error) {
+	f = &farm{}
+	defer func() {
+		if err != nil {
+			f.Close()
+		}
+	}()
+	for idx := 0; idx < size; idx++ {
+		cmd := exec.Command("/proc/self/exe")
+		cmd.Env = append(os.Environ(), parkEnvVar+"=1")
+		cmd.SysProcAttr = &syscall.SysProcAttr{
+			Cloneflags: syscall.CLONE_NEWNET | syscall.CLONE_NEWNS,
+			Pdeathsig:  syscall.SIGKILL,
+		}
+		stdin, err := cmd.StdinPipe()
+		if err != nil {
+			return f, err
+		}
+		if err := cmd.Start(); err != nil {
+			return f, err
+		}
+		pid := strconv.Itoa(cmd.Process.Pid)
+		m := farmMember{
+			cmd:   cmd,
+			stdin: stdin,
+			namespaces: []reexec.Namespace{
+				{Type: "!net", Path: "/proc/" + pid + "/ns/net"},
+				{Type: "!mnt", Path: "/proc/" + pid + "/ns/mnt"},
+			},
+			ids: nsIDs{
+				Net: nsino("/proc/" + pid + "/ns/net"),
+				Mnt: nsino("/proc/" + pid + "/ns/mnt"),
+			},
+		}
+		f.members = append(f.members, m)
+		if m.ids.Net == 0 || m.ids.Mnt == 0 || m.ids.Net == nsino("/proc/self/ns/net") {
+			return f, fmt.Errorf("farm process %s did not get new namespaces", pid)
+		}
+	}
+	return f, nil
+}
+
+// run re-executes into the namespaces of the specified farm member and
+// checks that the child really ended up there.
+func (f *farm) run(idx int) (time.Duration, error) {
+	m := &f.members[idx]
+	var ids nsIDs
+	start := time.Now()
+	err := reexec.RunReexecAction("nsids",
+		reexec.Namespaces(m.namespaces),
+		reexec.Result(&ids))
+	latency := time.Since(start)
+	if err == nil && ids != m.ids {
+		err = fmt.Errorf("child reported namespaces %+v instead of %+v", ids, m.ids)
+	}
+	return latency, err
+}
+
+// Close terminates all farm processes by closing their stdins and then reaps
+// them.
+func (f *farm) Close() {
+	for _, m := range f.members {
+		_ = m.stdin.Close()
+	}
+	for _, m := range f.members {
+		_ = m.cmd.Wait()
+	}
+	f.members = nil
+}
+
+// stats collects the latencies and errors of the re-executions.
+type stats struct {
+	mu       sync.Mutex
+	lats     []time.Duration // all latencies so far.
+	reported int             // number of latencies already reported.
+	errs     int
+	firsterr error
+}
+
+// record a single re-execution outcome.
+func (s *stats) record(latency time.Duration, err error) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	s.lats = append(s.lats, latency)
+	if err != nil {
+		s.errs++
+		if s.firsterr == nil {
+			s.firsterr = err
+		}
+	}
+}
+
+// interval returns the latencies recorded since the last call to interval.
+func (s *stats) interval() []time.Duration {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	lats := append([]time.Duration(nil), s.lats[s.reported:]...)
+	s.reported = len(s.lats)
+	return lats
+}
+
+func (s *stats) all() []time.Duration {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	return append([]time.Duration(nil), s.lats...)
+}
+
+func (s *stats) errors() int {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	return s.errs
+}
+
+func (s *stats) firstError() error {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	return s.firsterr
+}
+
+// report regularly prints the throughput, latency percentiles and leak
+// counters until told to stop.
+func (s *stats) report(interval time.Duration, stop <-chan struct{}, done chan<- struct{}) {
+	defer close(done)
+	ticker := time.NewTicker(interval)
+	defer ticker.Stop()
+	start := time.Now()
+	last := start
+	for {
+		select {
+		case <-stop:
+			return
+		case now := <-ticker.C:
+			lats := s.interval()
+			snap := sample()
+			fmt.Printf("%7.1fs %8.1f calls/s  %s  errors=%d fds=%d zombies=%d goroutines=%d\n",
+				now.Sub(start).Seconds(),
+				float64(len(lats))/now.Sub(last).Seconds(),
+				percentiles(lats), s.errors(),
+				snap.fds, snap.zombies, snap.goroutines)
+			last = now
+		}
+	}
+}
+
+// percentiles returns a textual summary of the latency percentiles.
+func percentiles(lats []time.Duration) string {
+	if len(lats) == 0 {
+		return "p50=- p90=- p99=- max=-"
+	}
+	sort.Slice(lats, func(i, j int) bool { return lats[i] < lats[j] })
+	p := func(q float64) time.Duration {
+		return lats[int(q*float64(len(lats)-1))].Round(time.Microsecond)
+	}
+	return fmt.Sprintf("p50=%s p90=%s p99=%s max=%s",
+		p(0.5), p(0.9), p(0.99), lats[len(lats)-1].Round(time.Microsecond))
+}
+
+// snapshot of the leak-relevant counters of this process.
+type snapshot struct {
+	fds        int
+	zombies    int
+	goroutines int
+}
+
+func sample() snapshot {
+	return snapshot{
+		fds:        openfds(),
+		zombies:    zombies(),
+		goroutines: runtime.NumGoroutine(),
+	}
+}
+
+// openfds returns the number of open fds of this process, or -1 if unknown.
+func openfds() int {
+	entries, err := os.ReadDir("/proc/self/fd")
+	if err != nil {
+		return -1
+	}
+	return len(entries) - 1 // ...don't count the fd used for reading the directory.
+}
+
+// zombies returns the number of zombie child processes of this process,
+// based on scanning /proc/[PID]/stat.
+func zombies() int {
+	entries, err := os.ReadDir("/proc")
+	if err != nil {
+		return -1
+	}
+	self := os.Getpid()
+	count := 0
+	for _, entry := range entries {
+		if _, err := strconv.Atoi(entry.Name()); err != nil {
+			continue
+		}
+		stat, err := os.ReadFile("/proc/" + entry.Name() + "/stat")
+		if err != nil {
+			continue // process has gone in the meantime.
+		}
+		state, ppid, err := parseStat(string(stat))
+		if err == nil && state == "Z" && ppid == self {
+			count++
+		}
+	}
+	return count
+}
+
+// parseStat returns the state and parent PID fields from the contents of a
+// /proc/[PID]/stat file. As the process name might contain spaces and
+// parentheses itself, we need to look for the last closing parenthesis.
+func parseStat(stat string) (state string, ppid int, err error) {
+	end := strings.LastIndexByte(stat, ')')
+	if end < 0 {
+		return "", 0, errors.New("malformed stat")
+	}
+	fields := strings.Fields(stat[end+1:])
+	if len(fields) < 2 {
+		return "", 0, errors.New("malformed stat")
+	}
+	ppid, err = strconv.Atoi(fields[1])
+	return fields[0], ppid, err
+}
@@ -42,5 +42,28 @@ returned to the parent process which initiated the re-execution.
 Please note that reexec.RunReexecAction() optionally accepts the namespaces to
 run the action in, as well as a parameter and/or environment variables. The
 result is picked up in the variable specified using reexec.Result().
+
+Applications with several components independently re-executing themselves
+can limit the number of concurrently running children as well as the spawn
+rate process-wide using reexec.SetAdmissionLimits(). Re-executions then wait
+for admission, with reexec.SpawnPriority(reexec.BackgroundPriority) letting
+interactive re-executions go first. reexec.Admission() reports the time spent
+waiting.
+
+As the work done inside re-executed children is invisible to profiling the
+parent, reexec.SetChildProfiling() makes children write CPU and heap profiles
+of their actions, with the CPU samples labelled by action name. Under test,
+children get profiled automatically when running with "-test.cpuprofile"
+and/or "-test.memprofile", with their profiles merged into the test's
+profiles.
+
+Large applications can spare their children from loading the complete
+application executable and running all its package init()s by running a slim
+helper executable instead, which links only the registered actions plus gons
+and calls reexec.HelperMain() from its main(). reexec.SetHelper() or the
+reexec.Helper() option select the helper, which reexec.LocateHelper() finds
+next to the application (but never along the PATH), and reexec.EmbedHelper()
+turns a helper image embedded into the application into an in-memory
+executable.
 */
 package reexec
@@ -0,0 +1,82 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"os"
+	"strings"
+)
+
+// EnvTemplate is a precomputed base environment for re-executed children,
+// to be used instead of copying this process' complete environment into
+// each and every child. The per-call environment of a child then is just
+// the template plus any runtime profile, Environment and "gons_*" variables.
+//
+// An EnvTemplate is immutable after creation and thus can be shared between
+// any number of concurrent re-executions.
+type EnvTemplate struct {
+	env []string
+}
+
+// NewEnvTemplate returns a new EnvTemplate containing only those variables
+// from the current environment whose names are in the allowlist. Allowlist
+// names ending in "*" match all variables with this name prefix, such as
+// "LC_*". Please note that the template is a snapshot of the environment at
+// the time of creating it.
+func NewEnvTemplate(allowlist ...string) *EnvTemplate {
+	t := &EnvTemplate{}
+	for _, v := range os.Environ() {
+		if allowed(envName(v), allowlist) {
+			t.env = append(t.env, v)
+		}
+	}
+	return t
+}
+
+// allowed returns true if the specified environment variable name is
+// matched by the allowlist.
+func allowed(name string, allowlist []string) bool {
+	for _, allow := range allowlist {
+		if strings.HasSuffix(allow, "*") {
+			if strings.HasPrefix(name, allow[:len(allow)-1]) {
+				return true
+			}
+		} else if name == allow {
+			return true
+		}
+	}
+	return false
+}
+
+// Environ returns a copy of the variables in this template.
+func (t *EnvTemplate) Environ() []string {
+	return append([]string(nil), t.env...)
+}
+
+// EnvironmentTemplate specifies a precomputed base environment for the
+// re-executed child, instead of this process' complete environment.
+func EnvironmentTemplate(template *EnvTemplate) ReexecActionOption {
+	return func(a *ReexecAction) {
+		a.EnvTemplate = template
+	}
+}
+
+// ScrubEnvironment scrubs the environment of the re-executed child down to
+// only the variables in the allowlist; see also NewEnvTemplate. The scrubbed
+// environment is computed only once when calling ScrubEnvironment, so
+// callers re-executing often should keep and reuse the returned option.
+func ScrubEnvironment(allowlist ...string) ReexecActionOption {
+	return EnvironmentTemplate(NewEnvTemplate(allowlist...))
+}
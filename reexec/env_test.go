@@ -0,0 +1,91 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"os"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+var _ = Describe("child environment", func() {
+
+	BeforeEach(func() {
+		os.Setenv("foobar", "baz!")
+		os.Setenv("foobaz", "bar!")
+		DeferCleanup(func() {
+			os.Unsetenv("foobar")
+			os.Unsetenv("foobaz")
+		})
+	})
+
+	It("creates allowlisted templates", func() {
+		Expect(NewEnvTemplate().Environ()).To(BeEmpty())
+		Expect(NewEnvTemplate("foobar", "nonexisting").Environ()).To(ConsistOf("foobar=baz!"))
+		Expect(NewEnvTemplate("foo*").Environ()).To(ConsistOf("foobar=baz!", "foobaz=bar!"))
+	})
+
+	It("snapshots the environment", func() {
+		t := NewEnvTemplate("foobar")
+		os.Setenv("foobar", "changed")
+		Expect(t.Environ()).To(ConsistOf("foobar=baz!"))
+	})
+
+	It("deduplicates overridden variables", func() {
+		Expect(dedupEnv([]string{"A=1", "B=2", "C=3", "A=4", "D", "C=5"}, 3)).To(Equal(
+			[]string{"B=2", "A=4", "D", "C=5"}))
+		Expect(dedupEnv([]string{"A=1", "A=2", "AB=3"}, 2)).To(Equal(
+			[]string{"A=1", "A=2", "AB=3"}))
+		Expect(dedupEnv([]string{"A=1", "A=2", "A=3"}, 1)).To(Equal(
+			[]string{"A=3"}))
+	})
+
+	It("notices namespaces changed in place", func() {
+		namespaces := []Namespace{{Type: "net", Path: "/proc/self/ns/net"}}
+		a := NewReexecAction("action", Namespaces(namespaces))
+		Expect(sameNamespaces(a.nsenvOf, a.Namespaces)).To(BeTrue())
+		namespaces[0].Path = "/proc/1/ns/net"
+		Expect(sameNamespaces(a.nsenvOf, a.Namespaces)).To(BeFalse())
+		Expect(sameNamespaces(a.nsenvOf,
+			[]Namespace{{Type: "net", Path: "/proc/self/ns/net"}})).To(BeTrue())
+	})
+
+	It("scrubs the child's environment", func() {
+		var s string
+		Expect(RunReexecAction("envvar", Result(&s))).To(Succeed())
+		Expect(s).To(Equal("baz!"))
+
+		Expect(RunReexecAction("envvar", ScrubEnvironment("PATH"), Result(&s))).To(Succeed())
+		Expect(s).To(BeEmpty())
+
+		scrub := ScrubEnvironment("foo*")
+		for i := 0; i < 2; i++ {
+			s = ""
+			Expect(RunReexecAction("envvar", scrub, Result(&s))).To(Succeed())
+			Expect(s).To(Equal("baz!"))
+		}
+	})
+
+	It("adds Environment on top of a template", func() {
+		var s string
+		Expect(RunReexecAction("envvar",
+			ScrubEnvironment(),
+			Environment([]string{"foobar=42"}),
+			Result(&s))).To(Succeed())
+		Expect(s).To(Equal("42"))
+	})
+
+})
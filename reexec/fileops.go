@@ -0,0 +1,349 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"encoding/json"
+	"errors"
+	"fmt"
+	"io"
+	"io/fs"
+	"os"
+	"sort"
+	"strconv"
+	"strings"
+	"syscall"
+	"time"
+	"unsafe"
+)
+
+// Names of the built-in actions serving file operations by re-executing into
+// mount namespaces whenever the /proc/PID/root fast path cannot be used.
+const (
+	readFileAction = "gons/reexec/readfile"
+	statAction     = "gons/reexec/stat"
+	readDirAction  = "gons/reexec/readdir"
+)
+
+func init() {
+	Register(readFileAction, func() { serveFileOp(readFileAction) })
+	Register(statAction, func() { serveFileOp(statAction) })
+	Register(readDirAction, func() { serveFileOp(readDirAction) })
+}
+
+// FileInfo describes a file as returned by Stat.
+type FileInfo struct {
+	Name    string
+	Size    int64
+	Mode    fs.FileMode
+	ModTime time.Time
+}
+
+// DirEntry describes an entry of a directory as returned by ReadDir.
+type DirEntry struct {
+	Name string
+	Type fs.FileMode // type bits of the entry's mode.
+}
+
+// ReadFile reads the named file as seen in the specified namespaces. If the
+// namespaces consist only of a mount namespace referenced as
+// "/proc/PID/ns/mnt", then the file gets read through /proc/PID/root without
+// any re-execution, resolving the path strictly inside the root of that
+// process. Otherwise, ReadFile falls back to re-executing, using the
+// specified options.
+func ReadFile(namespaces []Namespace, path string, options ...ReexecActionOption) ([]byte, error) {
+	if root := procRoot(namespaces); root != "" {
+		data, err := procRootReadFile(root, path)
+		if !errors.Is(err, errNoFastPath) {
+			return data, err
+		}
+	}
+	var res fileOpResult
+	if err := reexecFileOp(readFileAction, namespaces, path, &res, options); err != nil {
+		return nil, err
+	}
+	return res.Data, res.err("open", path)
+}
+
+// Stat returns information about the named file as seen in the specified
+// namespaces, following symbolic links. Please see ReadFile for when
+// re-execution can be avoided.
+func Stat(namespaces []Namespace, path string, options ...ReexecActionOption) (*FileInfo, error) {
+	if root := procRoot(namespaces); root != "" {
+		info, err := procRootStat(root, path)
+		if !errors.Is(err, errNoFastPath) {
+			return info, err
+		}
+	}
+	var res fileOpResult
+	if err := reexecFileOp(statAction, namespaces, path, &res, options); err != nil {
+		return nil, err
+	}
+	return res.Info, res.err("stat", path)
+}
+
+// ReadDir reads the named directory as seen in the specified namespaces,
+// returning its entries sorted by name. Please see ReadFile for when
+// re-execution can be avoided.
+func ReadDir(namespaces []Namespace, path string, options ...ReexecActionOption) ([]DirEntry, error) {
+	if root := procRoot(namespaces); root != "" {
+		entries, err := procRootReadDir(root, path)
+		if !errors.Is(err, errNoFastPath) {
+			return entries, err
+		}
+	}
+	var res fileOpResult
+	if err := reexecFileOp(readDirAction, namespaces, path, &res, options); err != nil {
+		return nil, err
+	}
+	return res.Entries, res.err("open", path)
+}
+
+// procRoot returns the "/proc/PID/root" directory that can serve file
+// operations in place of switching into the specified namespaces, or "" if
+// re-execution is needed. This is only the case if the namespaces consist of
+// just a single mount namespace referenced through its process: other
+// namespace types, such as the network namespace, change what procfs and
+// sysfs files show, and a user namespace changes file access permissions.
+func procRoot(namespaces []Namespace) string {
+	if len(namespaces) != 1 || strings.TrimPrefix(namespaces[0].Type, "!") != "mnt" {
+		return ""
+	}
+	path := namespaces[0].Path
+	if !strings.HasPrefix(path, "/proc/") || !strings.HasSuffix(path, "/ns/mnt") {
+		return ""
+	}
+	pid := path[len("/proc/") : len(path)-len("/ns/mnt")]
+	if pid != "self" {
+		if _, err := strconv.ParseUint(pid, 10, 31); err != nil {
+			return ""
+		}
+	}
+	return "/proc/" + pid + "/root"
+}
+
+// errNoFastPath signals that a file operation cannot be served through
+// /proc/PID/root, so it needs to be re-executed instead.
+var errNoFastPath = errors.New("no /proc/PID/root fast path")
+
+// openat2(2) bits, as the syscall package doesn't support openat2.
+const (
+	sysOpenat2          = 437      // same on all architectures.
+	oPath               = 0x200000 // O_PATH, except on alpha, parisc and sparc.
+	resolveNoMagiclinks = 0x02
+	resolveInRoot       = 0x10
+)
+
+// openHow is openat2's struct open_how.
+type openHow struct {
+	flags   uint64
+	mode    uint64
+	resolve uint64
+}
+
+// procRootOpen opens the specified path strictly inside the root directory
+// of a process, with absolute symbolic links and ".." resolving relative to
+// this root, never escaping from it. If the kernel doesn't support this, a
+// seccomp filter rejects it, or we cannot access the process' root, then it
+// returns errNoFastPath. It returns the fd of the opened path.
+func procRootOpen(root string, path string, flags int) (int, error) {
+	rootfd, err := syscall.Open(root, oPath|syscall.O_DIRECTORY|syscall.O_CLOEXEC, 0)
+	if err != nil {
+		if errors.Is(err, fs.ErrNotExist) {
+			// The process is gone, and so is its mount namespace.
+			return -1, &fs.PathError{Op: "open", Path: path, Err: err}
+		}
+		return -1, errNoFastPath
+	}
+	defer syscall.Close(rootfd)
+	p, err := syscall.BytePtrFromString(path)
+	if err != nil {
+		return -1, &fs.PathError{Op: "open", Path: path, Err: err}
+	}
+	how := openHow{
+		flags:   uint64(flags | syscall.O_CLOEXEC),
+		resolve: resolveInRoot | resolveNoMagiclinks,
+	}
+	fd, errno := openat2(rootfd, p, &how)
+	if errno != 0 {
+		if errno == syscall.ENOSYS || errno == syscall.EPERM && openat2Filtered(rootfd) {
+			return -1, errNoFastPath
+		}
+		return -1, &fs.PathError{Op: "open", Path: path, Err: errno}
+	}
+	return fd, nil
+}
+
+// openat2 calls openat2(2); tests replace it in order to simulate seccomp
+// filters.
+var openat2 = syscallOpenat2
+
+// syscallOpenat2 calls openat2(2), returning the new fd.
+func syscallOpenat2(dirfd int, path *byte, how *openHow) (int, syscall.Errno) {
+	fd, _, errno := syscall.Syscall6(sysOpenat2,
+		uintptr(dirfd), uintptr(unsafe.Pointer(path)),
+		uintptr(unsafe.Pointer(how)), unsafe.Sizeof(*how), 0, 0)
+	return int(fd), errno
+}
+
+// openat2Filtered reports whether openat2(2) fails with EPERM on its own, as
+// opposed to when resolving a specific path. Seccomp filters, such as older
+// container engines' default profiles, reject syscalls unknown to them with
+// EPERM instead of ENOSYS. To tell both cases apart, we simply try to open
+// the root directory itself, which must succeed unless openat2 is filtered.
+func openat2Filtered(rootfd int) bool {
+	how := openHow{
+		flags:   oPath | syscall.O_CLOEXEC,
+		resolve: resolveInRoot | resolveNoMagiclinks,
+	}
+	fd, errno := openat2(rootfd, &[]byte(".\x00")[0], &how)
+	if errno != 0 {
+		return errno == syscall.EPERM
+	}
+	_ = syscall.Close(fd)
+	return false
+}
+
+// procRootReadFile reads a file inside the root directory of a process.
+func procRootReadFile(root string, path string) ([]byte, error) {
+	fd, err := procRootOpen(root, path, syscall.O_RDONLY)
+	if err != nil {
+		return nil, err
+	}
+	f := os.NewFile(uintptr(fd), path)
+	defer f.Close()
+	return io.ReadAll(f)
+}
+
+// procRootStat stats a file inside the root directory of a process.
+func procRootStat(root string, path string) (*FileInfo, error) {
+	fd, err := procRootOpen(root, path, oPath)
+	if err != nil {
+		if pe, ok := err.(*fs.PathError); ok {
+			pe.Op = "stat"
+		}
+		return nil, err
+	}
+	f := os.NewFile(uintptr(fd), path)
+	defer f.Close()
+	info, err := f.Stat()
+	if err != nil {
+		return nil, err
+	}
+	return newFileInfo(info), nil
+}
+
+// procRootReadDir reads a directory inside the root directory of a process.
+func procRootReadDir(root string, path string) ([]DirEntry, error) {
+	fd, err := procRootOpen(root, path, syscall.O_RDONLY|syscall.O_DIRECTORY)
+	if err != nil {
+		return nil, err
+	}
+	// When a filesystem doesn't report entry types, os.DirEntry.Type()
+	// lstat()s the entry by prefixing it with the name of the directory.
+	// Passing the directory's path through /proc/PID/root would then be
+	// unsafe, as intermediate symbolic links would resolve outside the
+	// process root. Instead, we name the directory after its fd magic link,
+	// which refers exactly to the directory we've safely opened.
+	f := os.NewFile(uintptr(fd), "/proc/self/fd/"+strconv.Itoa(fd))
+	defer f.Close()
+	dirents, err := f.ReadDir(-1)
+	if err != nil {
+		return nil, err
+	}
+	entries := make([]DirEntry, len(dirents))
+	for idx, dirent := range dirents {
+		entries[idx] = DirEntry{Name: dirent.Name(), Type: dirent.Type()}
+	}
+	sort.Slice(entries, func(i, j int) bool { return entries[i].Name < entries[j].Name })
+	return entries, nil
+}
+
+// newFileInfo returns our serializable FileInfo for an fs.FileInfo.
+func newFileInfo(info fs.FileInfo) *FileInfo {
+	return &FileInfo{
+		Name:    info.Name(),
+		Size:    info.Size(),
+		Mode:    info.Mode(),
+		ModTime: info.ModTime(),
+	}
+}
+
+// fileOpResult is the result of a re-executed file operation, with errors
+// transferred as errno values, so that callers can still check for, say,
+// fs.ErrNotExist.
+type fileOpResult struct {
+	Data    []byte     `json:",omitempty"`
+	Info    *FileInfo  `json:",omitempty"`
+	Entries []DirEntry `json:",omitempty"`
+	Errno   int        `json:",omitempty"`
+	Error   string     `json:",omitempty"` // for errors without errno.
+}
+
+// err returns the error of a re-executed file operation, if any.
+func (r *fileOpResult) err(op string, path string) error {
+	switch {
+	case r.Errno != 0:
+		return &fs.PathError{Op: op, Path: path, Err: syscall.Errno(r.Errno)}
+	case r.Error != "":
+		return &fs.PathError{Op: op, Path: path, Err: errors.New(r.Error)}
+	}
+	return nil
+}
+
+// reexecFileOp runs the specified file operation in a re-executed child.
+func reexecFileOp(action string, namespaces []Namespace, path string, res *fileOpResult, options []ReexecActionOption) error {
+	opts := append(options[:len(options):len(options)],
+		Namespaces(namespaces), Param(path), Result(res))
+	return RunReexecAction(action, opts...)
+}
+
+// serveFileOp runs inside a re-executed child, carrying out the specified
+// file operation.
+func serveFileOp(action string) {
+	var path string
+	if err := json.NewDecoder(os.Stdin).Decode(&path); err != nil {
+		fmt.Fprintf(os.Stderr, "cannot decode path: %s", err.Error())
+		return
+	}
+	var res fileOpResult
+	var err error
+	switch action {
+	case readFileAction:
+		res.Data, err = os.ReadFile(path)
+	case statAction:
+		var info fs.FileInfo
+		if info, err = os.Stat(path); err == nil {
+			res.Info = newFileInfo(info)
+		}
+	case readDirAction:
+		var entries []os.DirEntry
+		if entries, err = os.ReadDir(path); err == nil {
+			res.Entries = make([]DirEntry, len(entries))
+			for idx, entry := range entries {
+				res.Entries[idx] = DirEntry{Name: entry.Name(), Type: entry.Type()}
+			}
+		}
+	}
+	if err != nil {
+		var errno syscall.Errno
+		if errors.As(err, &errno) {
+			res.Errno = int(errno)
+		} else {
+			res.Error = err.Error()
+		}
+	}
+	_ = json.NewEncoder(os.Stdout).Encode(&res)
+}
@@ -0,0 +1,168 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"errors"
+	"io/fs"
+	"os"
+	"path/filepath"
+	"strconv"
+	"syscall"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+var _ = Describe("file operations", func() {
+
+	mntns := []Namespace{{Type: "mnt", Path: "/proc/self/ns/mnt"}}
+	// Switching into the network namespace as well prevents the fast path.
+	slowns := []Namespace{
+		{Type: "!mnt", Path: "/proc/self/ns/mnt"},
+		{Type: "!net", Path: "/proc/self/ns/net"},
+	}
+
+	var tmpdir string
+
+	BeforeEach(func() {
+		var err error
+		tmpdir, err = os.MkdirTemp("", "gons-fileops-")
+		Expect(err).NotTo(HaveOccurred())
+		DeferCleanup(func() { os.RemoveAll(tmpdir) })
+		Expect(os.WriteFile(filepath.Join(tmpdir, "foo"), []byte("foo!"), 0644)).To(Succeed())
+		Expect(os.Mkdir(filepath.Join(tmpdir, "bar"), 0755)).To(Succeed())
+		Expect(os.Symlink("foo", filepath.Join(tmpdir, "baz"))).To(Succeed())
+	})
+
+	It("finds the /proc/PID/root fast path", func() {
+		Expect(procRoot(nil)).To(BeEmpty())
+		Expect(procRoot(mntns)).To(Equal("/proc/self/root"))
+		Expect(procRoot([]Namespace{{Type: "!mnt", Path: "/proc/42/ns/mnt"}})).To(Equal("/proc/42/root"))
+		Expect(procRoot([]Namespace{{Type: "mnt", Path: "/proc/4x2/ns/mnt"}})).To(BeEmpty())
+		Expect(procRoot([]Namespace{{Type: "mnt", Path: "/run/mntns"}})).To(BeEmpty())
+		Expect(procRoot([]Namespace{{Type: "net", Path: "/proc/42/ns/net"}})).To(BeEmpty())
+		Expect(procRoot(slowns)).To(BeEmpty())
+	})
+
+	It("stays inside the process root", func() {
+		root := "/proc/" + strconv.Itoa(os.Getpid()) + "/root"
+		data, err := procRootReadFile(root, filepath.Join(tmpdir, "baz"))
+		Expect(err).NotTo(HaveOccurred())
+		Expect(string(data)).To(Equal("foo!"))
+		// Magic links are a no-go.
+		_, err = procRootReadFile(root, "/proc/self/root"+filepath.Join(tmpdir, "foo"))
+		Expect(err).To(HaveOccurred())
+		_, err = procRootReadFile("/proc/0/root", "/etc/hostname")
+		Expect(err).To(MatchError(MatchRegexp(`no such file`)))
+	})
+
+	It("falls back to re-execution when openat2 is filtered", func() {
+		defer func(orig func(int, *byte, *openHow) (int, syscall.Errno)) {
+			openat2 = orig
+		}(openat2)
+		filtered := func(int, *byte, *openHow) (int, syscall.Errno) {
+			return -1, syscall.EPERM
+		}
+		openat2 = filtered
+		_, err := procRootReadFile(procRoot(mntns), filepath.Join(tmpdir, "foo"))
+		Expect(err).To(MatchError(errNoFastPath))
+		data, err := ReadFile(mntns, filepath.Join(tmpdir, "foo"))
+		Expect(err).NotTo(HaveOccurred())
+		Expect(string(data)).To(Equal("foo!"))
+
+		// Permission problems with paths are no reason to fall back.
+		openat2 = func(dirfd int, path *byte, how *openHow) (int, syscall.Errno) {
+			if *path != '.' {
+				return filtered(dirfd, path, how)
+			}
+			return syscallOpenat2(dirfd, path, how)
+		}
+		_, err = procRootReadFile(procRoot(mntns), filepath.Join(tmpdir, "foo"))
+		Expect(err).To(MatchError(syscall.EPERM))
+		Expect(errors.Is(err, errNoFastPath)).To(BeFalse())
+	})
+
+	// In the fast cases, we call the /proc/PID/root implementations directly,
+	// as otherwise silently falling back to re-execution would go unnoticed.
+	for _, fast := range []bool{true, false} {
+		fast := fast
+		readFile := func(path string) ([]byte, error) {
+			if fast {
+				return procRootReadFile(procRoot(mntns), path)
+			}
+			return ReadFile(slowns, path)
+		}
+		stat := func(path string) (*FileInfo, error) {
+			if fast {
+				return procRootStat(procRoot(mntns), path)
+			}
+			return Stat(slowns, path)
+		}
+		readDir := func(path string) ([]DirEntry, error) {
+			if fast {
+				return procRootReadDir(procRoot(mntns), path)
+			}
+			return ReadDir(slowns, path)
+		}
+
+		It("reads files (fast: "+strconv.FormatBool(fast)+")", func() {
+			data, err := readFile(filepath.Join(tmpdir, "baz"))
+			Expect(err).NotTo(HaveOccurred())
+			Expect(string(data)).To(Equal("foo!"))
+			_, err = readFile(filepath.Join(tmpdir, "nonexisting"))
+			Expect(err).To(MatchError(fs.ErrNotExist))
+		})
+
+		It("stats files (fast: "+strconv.FormatBool(fast)+")", func() {
+			info, err := stat(filepath.Join(tmpdir, "baz"))
+			Expect(err).NotTo(HaveOccurred())
+			Expect(info.Name).To(Equal("baz"))
+			Expect(info.Size).To(Equal(int64(4)))
+			Expect(info.Mode.IsRegular()).To(BeTrue())
+			info, err = stat(filepath.Join(tmpdir, "bar"))
+			Expect(err).NotTo(HaveOccurred())
+			Expect(info.Mode.IsDir()).To(BeTrue())
+			_, err = stat(filepath.Join(tmpdir, "nonexisting"))
+			Expect(err).To(MatchError(fs.ErrNotExist))
+		})
+
+		It("reads directories (fast: "+strconv.FormatBool(fast)+")", func() {
+			entries, err := readDir(tmpdir)
+			Expect(err).NotTo(HaveOccurred())
+			Expect(entries).To(Equal([]DirEntry{
+				{Name: "bar", Type: fs.ModeDir},
+				{Name: "baz", Type: fs.ModeSymlink},
+				{Name: "foo", Type: 0},
+			}))
+			_, err = readDir(filepath.Join(tmpdir, "foo"))
+			Expect(err).To(HaveOccurred())
+			Expect(errors.Is(err, errNoFastPath)).To(BeFalse())
+		})
+	}
+
+	It("serves file operations on the fast path", func() {
+		data, err := ReadFile(mntns, filepath.Join(tmpdir, "foo"))
+		Expect(err).NotTo(HaveOccurred())
+		Expect(string(data)).To(Equal("foo!"))
+		info, err := Stat(mntns, filepath.Join(tmpdir, "bar"))
+		Expect(err).NotTo(HaveOccurred())
+		Expect(info.Mode.IsDir()).To(BeTrue())
+		entries, err := ReadDir(mntns, tmpdir)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(entries).To(HaveLen(3))
+	})
+
+})
@@ -0,0 +1,212 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"fmt"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"runtime"
+	"strconv"
+	"sync"
+	"sync/atomic"
+	"syscall"
+	"unsafe"
+)
+
+// Re-executing ourselves means that every child loads our complete
+// executable and runs all package init()s before CheckAction() finally gets
+// to dispatch the action. For large applications this quickly dominates the
+// cost of short-lived actions. So applications can instead re-execute a
+// separate, slim helper executable that links only the registered actions
+// plus gons, speaking the same environment protocol and returning results the
+// same way.
+//
+// A helper's main() is just:
+//
+//	func main() {
+//	    reexec.HelperMain()
+//	}
+//
+// with the helper importing the packages registering the actions it is to
+// serve.
+
+// processHelper is the argument vector of the process-wide helper executable
+// set using SetHelper, if any.
+var processHelper atomic.Pointer[[]string]
+
+// SetHelper sets the helper executable to run instead of re-executing
+// ourselves, for all re-executions not specifying their own helper using the
+// Helper option. An empty path switches back to re-executing ourselves.
+func SetHelper(path string) {
+	if path == "" {
+		processHelper.Store(nil)
+		return
+	}
+	processHelper.Store(&[]string{path})
+}
+
+// Helper specifies the helper executable to run instead of re-executing
+// ourselves. An empty path stands for the process-wide helper set using
+// SetHelper, if any.
+//
+// As the helper isn't a copy of ourselves, the action isn't required to be
+// registered in this process, but only in the helper. Also, children running
+// a helper don't take part in coverage profiling, as the helper isn't our
+// test binary.
+func Helper(path string) ReexecActionOption {
+	var argv []string
+	if path != "" {
+		argv = []string{path}
+	}
+	return func(a *ReexecAction) {
+		a.Helper = path
+		a.helperArgv = argv
+	}
+}
+
+// helper returns the argument vector for running the helper executable of
+// this action, or nil if we're going to re-execute ourselves.
+func (a *ReexecAction) helper() []string {
+	if a.Helper == "" {
+		if argv := processHelper.Load(); argv != nil {
+			return *argv
+		}
+		return nil
+	}
+	if a.helperArgv == nil || a.helperArgv[0] != a.Helper {
+		return []string{a.Helper}
+	}
+	return a.helperArgv
+}
+
+// HelperMain is the main function of a helper executable: it runs the action
+// specified by its parent and then exits. When not started by a parent
+// wanting an action to be run, it complains and exits with code 2.
+func HelperMain() {
+	if !RunAction() {
+		fmt.Fprintln(os.Stderr,
+			"gons/reexec: HelperMain: helper is to be run only by gons/reexec")
+		osExit(2)
+		return
+	}
+	osExit(0)
+}
+
+// LocateHelper returns the absolute path of the named helper executable,
+// looking only next to our own executable, so helpers get shipped alongside
+// their applications. Deliberately, the PATH isn't searched, as otherwise
+// whoever controls the PATH would control what our children run, with all
+// our privileges and inside all the namespaces we switch them into. Absolute
+// paths are only checked to be executable files, while relative paths
+// containing slashes are rejected.
+func LocateHelper(name string) (string, error) {
+	path := name
+	if !filepath.IsAbs(name) {
+		if filepath.Base(name) != name {
+			return "", fmt.Errorf(
+				"gons/reexec: LocateHelper: cannot locate helper %q, reason: neither a plain name nor an absolute path",
+				name)
+		}
+		exe, err := os.Executable()
+		if err != nil {
+			return "", fmt.Errorf(
+				"gons/reexec: LocateHelper: cannot locate helper %q, reason: %w",
+				name, err)
+		}
+		path = filepath.Join(filepath.Dir(exe), name)
+	}
+	if _, err := exec.LookPath(path); err != nil {
+		return "", fmt.Errorf(
+			"gons/reexec: LocateHelper: cannot locate helper %q, reason: %w",
+			name, err)
+	}
+	return path, nil
+}
+
+// memfdCreateSyscalls maps architectures to their memfd_create(2) syscall
+// numbers, which Go's syscall package doesn't know of.
+var memfdCreateSyscalls = map[string]uintptr{
+	"386":     356,
+	"amd64":   319,
+	"arm":     385,
+	"arm64":   279,
+	"loong64": 279,
+	"ppc64":   360,
+	"ppc64le": 360,
+	"riscv64": 279,
+	"s390x":   350,
+}
+
+// MFD_CLOEXEC flag for memfd_create(2).
+const mfdCloexec = 0x0001
+
+// embeddedHelpers keeps the in-memory files of embedded helpers open (and out
+// of reach of their finalizers) for the remaining lifetime of this process.
+var (
+	embeddedHelpers   []*os.File
+	embeddedHelpersMu sync.Mutex
+)
+
+// EmbedHelper turns the specified helper executable image, such as a helper
+// binary included using go:embed, into an anonymous in-memory file and
+// returns a path suitable for Helper and SetHelper. The in-memory file lives
+// as long as this process, so applications need neither to ship nor to
+// locate a separate helper file, and it even works with read-only and
+// noexec filesystems. The name is only informational, showing up as the link
+// target of the path.
+func EmbedHelper(name string, image []byte) (string, error) {
+	sysno, ok := memfdCreateSyscalls[runtime.GOARCH]
+	if !ok {
+		return "", fmt.Errorf(
+			"gons/reexec: EmbedHelper: in-memory files not supported on %s",
+			runtime.GOARCH)
+	}
+	cname, err := syscall.BytePtrFromString(name)
+	if err != nil {
+		return "", fmt.Errorf("gons/reexec: EmbedHelper: invalid name %q", name)
+	}
+	fd, _, errno := syscall.Syscall(sysno, uintptr(unsafe.Pointer(cname)), mfdCloexec, 0)
+	if errno != 0 {
+		return "", fmt.Errorf(
+			"gons/reexec: EmbedHelper: cannot create in-memory file, reason: %w",
+			errno)
+	}
+	memf := os.NewFile(fd, name)
+	if _, err := memf.Write(image); err != nil {
+		_ = memf.Close()
+		return "", fmt.Errorf(
+			"gons/reexec: EmbedHelper: cannot write helper image, reason: %w",
+			err)
+	}
+	// The kernel refuses to execute files still open for writing, failing
+	// with ETXTBSY, so we reopen the in-memory file read-only and drop our
+	// writable file descriptor. As the writable file descriptor is our only
+	// reference to the in-memory file, it has to stay open until we've
+	// reopened the file, but not a moment longer: children forked by other
+	// goroutines meanwhile inherit a copy of it until they exec.
+	helperf, err := os.Open("/proc/self/fd/" + strconv.Itoa(int(fd)))
+	_ = memf.Close()
+	if err != nil {
+		return "", fmt.Errorf(
+			"gons/reexec: EmbedHelper: cannot reopen in-memory file, reason: %w",
+			err)
+	}
+	embeddedHelpersMu.Lock()
+	embeddedHelpers = append(embeddedHelpers, helperf)
+	embeddedHelpersMu.Unlock()
+	return "/proc/self/fd/" + strconv.Itoa(int(helperf.Fd())), nil
+}
@@ -0,0 +1,171 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"bytes"
+	"errors"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"testing"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+// buildHelper builds the reexechelper command into the specified directory
+// and returns the path of the helper executable.
+func buildHelper(dir string) (string, error) {
+	gobin, err := exec.LookPath("go")
+	if err != nil {
+		gobin = filepath.Join(os.Getenv("GOROOT"), "bin", "go")
+	}
+	helper := filepath.Join(dir, "reexechelper")
+	out, err := exec.Command(gobin, "build", "-o", helper, "./cmd/reexechelper").CombinedOutput()
+	if err != nil {
+		return "", errors.New(string(out) + err.Error())
+	}
+	return helper, nil
+}
+
+var _ = Describe("helper executables", func() {
+
+	var tmpdir, helper string
+
+	BeforeEach(func() {
+		var err error
+		tmpdir, err = os.MkdirTemp("", "reexechelper-*")
+		Expect(err).NotTo(HaveOccurred())
+		helper, err = buildHelper(tmpdir)
+		if err != nil {
+			os.RemoveAll(tmpdir)
+			Skip("cannot build helper: " + err.Error())
+		}
+	})
+
+	AfterEach(func() {
+		os.RemoveAll(tmpdir)
+	})
+
+	It("runs actions in a helper instead of ourselves", func() {
+		cmdline, err := ReadFile(nil, "/proc/self/cmdline", Helper(helper))
+		Expect(err).NotTo(HaveOccurred())
+		Expect(string(cmdline)).To(Equal(helper + "\x00"))
+
+		SetHelper(helper)
+		defer SetHelper("")
+		cmdline, err = ReadFile(nil, "/proc/self/cmdline")
+		Expect(err).NotTo(HaveOccurred())
+		Expect(string(cmdline)).To(Equal(helper + "\x00"))
+
+		SetHelper("")
+		cmdline, err = ReadFile(nil, "/proc/self/cmdline")
+		Expect(err).NotTo(HaveOccurred())
+		Expect(string(cmdline)).To(HavePrefix(selfExe + "\x00"))
+	})
+
+	It("leaves checking action registrations to helpers", func() {
+		var s string
+		err := RunReexecAction("gons/reexec/nonexisting", Helper(helper), Result(&s))
+		Expect(err).To(HaveOccurred())
+		Expect(err.Error()).To(ContainSubstring("unregistered gons/reexec re-execution action"))
+	})
+
+	It("reports missing helpers", func() {
+		var s string
+		err := RunReexecAction("action",
+			Helper(filepath.Join(tmpdir, "nonexisting")), Result(&s))
+		Expect(err).To(HaveOccurred())
+		Expect(err.Error()).To(ContainSubstring("cannot start helper"))
+	})
+
+	It("complains when run directly", func() {
+		var stderr bytes.Buffer
+		cmd := exec.Command(helper)
+		cmd.Stderr = &stderr
+		err := cmd.Run()
+		var exiterr *exec.ExitError
+		Expect(errors.As(err, &exiterr)).To(BeTrue())
+		Expect(exiterr.ExitCode()).To(Equal(2))
+		Expect(stderr.String()).To(ContainSubstring("to be run only by gons/reexec"))
+	})
+
+	It("locates helpers", func() {
+		located, err := LocateHelper(helper)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(located).To(Equal(helper))
+		_, err = LocateHelper("sh")
+		Expect(err).To(HaveOccurred(), "helper located along PATH")
+		Expect(err.Error()).To(ContainSubstring("cannot locate helper"))
+		_, err = LocateHelper("./sh")
+		Expect(err).To(HaveOccurred())
+		Expect(err.Error()).To(ContainSubstring("neither a plain name nor an absolute path"))
+	})
+
+	It("locates helpers next to our executable", func() {
+		exe, err := os.Executable()
+		Expect(err).NotTo(HaveOccurred())
+		sibling := filepath.Join(filepath.Dir(exe), "gons-reexec-test-helper")
+		if err := os.Symlink(helper, sibling); err != nil {
+			Skip("cannot place helper next to test binary: " + err.Error())
+		}
+		defer os.Remove(sibling)
+		located, err := LocateHelper("gons-reexec-test-helper")
+		Expect(err).NotTo(HaveOccurred())
+		Expect(located).To(Equal(sibling))
+	})
+
+	It("runs embedded helpers", func() {
+		image, err := os.ReadFile(helper)
+		Expect(err).NotTo(HaveOccurred())
+		embedded, err := EmbedHelper("reexechelper", image)
+		Expect(err).NotTo(HaveOccurred())
+		readback, err := os.ReadFile(embedded)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(bytes.Equal(readback, image)).To(BeTrue())
+		cmdline, err := ReadFile(nil, "/proc/self/cmdline", Helper(embedded))
+		Expect(err).NotTo(HaveOccurred())
+		Expect(string(cmdline)).To(Equal(embedded + "\x00"))
+	})
+
+})
+
+// BenchmarkHelperStartup compares re-executing ourselves to running the slim
+// reexechelper for the same built-in action. As our test binary is still
+// slim compared to most applications, the real savings tend to be even
+// larger.
+func BenchmarkHelperStartup(b *testing.B) {
+	helper, err := buildHelper(b.TempDir())
+	if err != nil {
+		b.Skip("cannot build helper: " + err.Error())
+	}
+	for _, bm := range []struct {
+		name   string
+		helper string
+	}{
+		{name: "self"},
+		{name: "helper", helper: helper},
+	} {
+		b.Run(bm.name, func(b *testing.B) {
+			opt := Helper(bm.helper)
+			for n := 0; n < b.N; n++ {
+				if _, err := Stat(nil, "/", opt); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+}
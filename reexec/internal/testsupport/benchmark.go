@@ -0,0 +1,25 @@
+// Copyright 2020 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package testsupport
+
+// RunBenchmarkAction is set when gons/reexec initializes, so that
+// gons/reexec/testing can re-execute a benchmark in the specified namespaces
+// without importing gons/reexec.
+var RunBenchmarkAction func(namespaces []Namespace, param interface{}, result interface{}) error
+
+// ServeBenchmark is set when gons/reexec/testing initializes, so that the
+// built-in benchmark action of gons/reexec can run the benchmark requested by
+// the parent inside the re-executed child.
+var ServeBenchmark func()
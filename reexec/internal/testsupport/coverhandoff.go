@@ -0,0 +1,63 @@
+// Copyright 2020 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package testsupport
+
+import (
+	"io"
+	"os"
+	"sync"
+)
+
+// CoverageHandOffProfile is the coverage profile data "file" of a re-executed
+// child that hands off its coverage profile data to its parent: it's the
+// write end of a pipe that must be passed to the child as its fd 3.
+const CoverageHandOffProfile = "/proc/self/fd/3"
+
+// CoverageHandOff, when set by gons/reexec/testing before any tests run,
+// receives the textual coverage profile data of each re-executed child
+// through a pipe, instead of the child writing a coverage profile data file
+// of its own that would need to be read back and deleted later. It gets
+// called in a separate go routine per child and must read until EOF.
+var CoverageHandOff func(r io.Reader)
+
+// handoffs keeps track of the go routines receiving coverage profile data
+// from children.
+var handoffs sync.WaitGroup
+
+// WaitCoverageHandOffs waits for all coverage profile data handed off by
+// children so far to be received.
+func WaitCoverageHandOffs() {
+	handoffs.Wait()
+}
+
+// coverageHandOff returns the write end of a new pipe for a re-executed child
+// to hand off its coverage profile data through, with the data received by
+// CoverageHandOff. It returns nil if no pipe could be created.
+func coverageHandOff() *os.File {
+	r, w, err := os.Pipe()
+	if err != nil {
+		return nil
+	}
+	handoffs.Add(1)
+	go func() {
+		defer handoffs.Done()
+		defer r.Close()
+		CoverageHandOff(r)
+		// Don't leave a child blocked when writing its coverage profile data
+		// in case CoverageHandOff bailed out early.
+		_, _ = io.Copy(io.Discard, r)
+	}()
+	return w
+}
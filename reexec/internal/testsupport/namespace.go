@@ -0,0 +1,23 @@
+// Copyright 2020 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package testsupport
+
+// Namespace describes a Linux kernel namespace into which a forked and
+// re-executed child process should switch; please see gons/reexec.Namespace
+// for details.
+type Namespace struct {
+	Type string // namespace type, such as "net", "mnt", ...
+	Path string // path reference to namespace in filesystem.
+}
@@ -0,0 +1,62 @@
+// Copyright 2020 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package testsupport
+
+import "sync"
+
+// ChildCPUProfile and ChildHeapProfile are the path prefixes of the CPU and
+// heap profiles of re-executed children when under test with
+// "-test.cpuprofile" and "-test.memprofile" respectively. If empty, children
+// don't get profiled. Similar to CoverageProfile, they are set only once by
+// EnableProfiling before any tests run, and only read afterwards.
+var (
+	ChildCPUProfile  = ""
+	ChildHeapProfile = ""
+)
+
+// EnableProfiling is a module-internal function used by the
+// gons/reexec/testing (sub) package to tell gons/reexec to profile the
+// re-executed children, with the children's profiles written next to the
+// parent's profiles.
+func EnableProfiling(cpuprofile, heapprofile string) {
+	ChildCPUProfile = cpuprofile
+	ChildHeapProfile = heapprofile
+}
+
+// childProfiles are the names of the profile files written by re-executed
+// children when under test, indexed by the path prefix of their child
+// profiles. As tests might re-execute from multiple go routines, they are
+// protected by childProfilesMu.
+var (
+	childProfiles   = map[string][]string{}
+	childProfilesMu sync.Mutex
+)
+
+// AddChildProfile records the name of a profile file written by a re-executed
+// child when under test, for later merging into the parent's profile with the
+// specified path prefix.
+func AddChildProfile(prefix, name string) {
+	childProfilesMu.Lock()
+	defer childProfilesMu.Unlock()
+	childProfiles[prefix] = append(childProfiles[prefix], name)
+}
+
+// ChildProfiles returns the names of the profile files written by re-executed
+// children so far for the parent's profile with the specified path prefix.
+func ChildProfiles(prefix string) []string {
+	childProfilesMu.Lock()
+	defer childProfilesMu.Unlock()
+	return append([]string(nil), childProfiles[prefix]...)
+}
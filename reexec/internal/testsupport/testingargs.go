@@ -16,10 +16,15 @@ package testsupport
 
 import (
 	"fmt"
+	"os"
+	"sync"
+	"sync/atomic"
 )
 
 // TestingEnabled is set to true when we're under testing; gathering coverage
-// profile data might be enabled.
+// profile data might be enabled. Together with CoverageOutputDir,
+// CoverageProfile and CoverageDir it is set only once by EnableTesting before
+// any tests run, and only read afterwards.
 var TestingEnabled = false
 
 // CoverageOutputDir is the directory in which to create profile files and the
@@ -34,34 +39,89 @@ var CoverageOutputDir = ""
 // "-test.coverprofile" CLI argument.
 var CoverageProfile = ""
 
+// CoverageDir is the directory into which binaries built with Go 1.20's
+// redesigned coverage write their binary coverage meta and counter data
+// files; if empty, re-executed children fall back to writing textual coverage
+// profile data files. This variable corresponds with the "-test.gocoverdir"
+// CLI argument.
+var CoverageDir = ""
+
 // EnableTesting is a module-internal function used by the gons/reexec/testing
 // (sub) package; it tells this reexec package when we're in testing mode, and
 // also passes coverage profiling-related test parameters to us. We need these
 // parameters when re-executing child processes and in order to allocate
 // coverage profile data files to these children.
-func EnableTesting(outputdir, coverprofile string) {
+func EnableTesting(outputdir, coverprofile, coverdir string) {
 	TestingEnabled = true
 	CoverageOutputDir = outputdir
 	CoverageProfile = coverprofile
+	CoverageDir = coverdir
+}
+
+// coverageProfiles is a list of coverage profile data filenames created by
+// re-executed child processes when under test. As tests might re-execute
+// from multiple go routines, it is protected by coverageProfilesMu.
+var (
+	coverageProfiles   []string
+	coverageProfilesMu sync.Mutex
+)
+
+// childSerial is the serial number of the most recently re-executed child
+// that got a coverage profile data file allocated. Together with our PID it
+// uniquely identifies each child's coverage profile data file, even when
+// parallel tests re-execute concurrently and multiple test processes share
+// the same output directory.
+var childSerial uint64
+
+// childCoverageProfile returns the name of a new and unique coverage profile
+// data file for a re-executed child, and records it for later merging.
+func childCoverageProfile() string {
+	name := fmt.Sprintf("%s_%d_%d",
+		CoverageProfile, os.Getpid(), atomic.AddUint64(&childSerial, 1))
+	coverageProfilesMu.Lock()
+	coverageProfiles = append(coverageProfiles, name)
+	coverageProfilesMu.Unlock()
+	return name
 }
 
-// CoverageProfiles is a list of coverage profile data filenames created by
-// re-executed child processes when under test.
-var CoverageProfiles = []string{}
+// CoverageProfiles returns the list of coverage profile data filenames
+// allocated to re-executed child processes so far.
+func CoverageProfiles() []string {
+	coverageProfilesMu.Lock()
+	defer coverageProfilesMu.Unlock()
+	return append([]string(nil), coverageProfiles...)
+}
 
 // TestingArgs returns additional testing arguments while under test;
-// otherwise it returns an empty slice of arguments.
-func TestingArgs() []string {
-	testargs := []string{}
+// otherwise it returns an empty slice of arguments. If the child is to hand
+// off its coverage profile data through a pipe, then TestingArgs additionally
+// returns the write end of the pipe, which the caller must pass to the child
+// as its fd 3 and then close. It is safe to call TestingArgs from multiple go
+// routines concurrently.
+func TestingArgs() (testargs []string, coverfile *os.File) {
+	testargs = []string{}
 	if TestingEnabled {
-		if CoverageProfile != "" {
-			name := CoverageProfile +
-				fmt.Sprintf("_%d", len(CoverageProfiles))
-			CoverageProfiles = append(CoverageProfiles, name)
-			if CoverageProfile != "" {
-				testargs = append(testargs,
-					"-test.coverprofile="+name)
+		switch {
+		case CoverageDir != "":
+			// Children write their binary coverage data files into the very
+			// same directory as the parent, where they get picked up by the
+			// parent's testing.M.Run() when it finally writes its coverage
+			// profile. No textual profiles, no merging on our side.
+			testargs = append(testargs,
+				"-test.gocoverdir="+CoverageDir)
+		case CoverageProfile != "":
+			// Preferably, children hand off their coverage profile data
+			// through a pipe, so it never touches the disk. Otherwise, each
+			// child gets its own coverage profile data file.
+			if CoverageHandOff != nil {
+				if coverfile = coverageHandOff(); coverfile != nil {
+					testargs = append(testargs,
+						"-test.coverprofile="+CoverageHandOffProfile)
+					break
+				}
 			}
+			testargs = append(testargs,
+				"-test.coverprofile="+childCoverageProfile())
 			if CoverageOutputDir != "" {
 				testargs = append(testargs,
 					"-test.outputdir="+CoverageOutputDir)
@@ -73,5 +133,5 @@ func TestingArgs() []string {
 			"-test.run=nadazilchnixdairgendwoimnirvanavonbielefeld",
 		)
 	}
-	return testargs
+	return
 }
@@ -15,6 +15,12 @@
 package testsupport
 
 import (
+	"fmt"
+	"io"
+	"os"
+	"sync"
+	"sync/atomic"
+
 	. "github.com/onsi/ginkgo/v2"
 	. "github.com/onsi/gomega"
 )
@@ -23,12 +29,80 @@ var _ = Describe("testing-related args", func() {
 
 	It("correctly generates child's testing-related args", func() {
 		defer func(et bool) { TestingEnabled = et }(TestingEnabled)
-		defer func() { CoverageProfiles = []string{} }()
-		EnableTesting("/foo", "bar")
-		tstargs := TestingArgs()
-		Expect(tstargs).To(ContainElement("-test.coverprofile=bar_0"))
+		defer func() { coverageProfiles = nil }()
+		EnableTesting("/foo", "bar", "")
+		tstargs, coverfile := TestingArgs()
+		Expect(coverfile).To(BeNil())
+		name := fmt.Sprintf("bar_%d_%d", os.Getpid(), atomic.LoadUint64(&childSerial))
+		Expect(tstargs).To(ContainElement("-test.coverprofile=" + name))
 		Expect(tstargs).To(ContainElement("-test.outputdir=/foo"))
 		Expect(tstargs).To(ContainElement(MatchRegexp("-test.run=.+")))
+		Expect(CoverageProfiles()).To(ConsistOf(name))
+	})
+
+	It("lets children write binary coverage data into the parent's directory", func() {
+		defer func(et bool) { TestingEnabled = et }(TestingEnabled)
+		defer func() { CoverageDir = "" }()
+		EnableTesting("/foo", "bar", "/covdata")
+		tstargs, coverfile := TestingArgs()
+		Expect(coverfile).To(BeNil())
+		Expect(tstargs).To(ContainElement("-test.gocoverdir=/covdata"))
+		Expect(tstargs).NotTo(ContainElement(HavePrefix("-test.coverprofile=")))
+		Expect(tstargs).To(ContainElement(MatchRegexp("-test.run=.+")))
+		Expect(CoverageProfiles()).To(BeEmpty())
+	})
+
+	It("hands off child coverage profile data through a pipe", func() {
+		defer func(et bool) { TestingEnabled = et }(TestingEnabled)
+		defer func() { CoverageHandOff = nil }()
+		var received []string
+		var mu sync.Mutex
+		CoverageHandOff = func(r io.Reader) {
+			data, _ := io.ReadAll(r)
+			mu.Lock()
+			defer mu.Unlock()
+			received = append(received, string(data))
+		}
+		EnableTesting("/foo", "bar", "")
+		tstargs, coverfile := TestingArgs()
+		Expect(coverfile).NotTo(BeNil())
+		Expect(tstargs).To(ContainElement("-test.coverprofile=" + CoverageHandOffProfile))
+		Expect(tstargs).NotTo(ContainElement(HavePrefix("-test.outputdir=")))
+		Expect(CoverageProfiles()).To(BeEmpty())
+		_, err := coverfile.WriteString("mode: atomic\n")
+		Expect(err).NotTo(HaveOccurred())
+		Expect(coverfile.Close()).To(Succeed())
+		WaitCoverageHandOffs()
+		mu.Lock()
+		defer mu.Unlock()
+		Expect(received).To(HaveLen(1))
+		Expect(received[0]).To(Equal("mode: atomic\n"))
+	})
+
+	It("allocates unique child profile names concurrently", func() {
+		defer func(et bool) { TestingEnabled = et }(TestingEnabled)
+		defer func() { coverageProfiles = nil }()
+		EnableTesting("", "bar", "")
+		_, _ = TestingArgs()
+		earlier := CoverageProfiles()
+		coverageProfiles = nil
+		var wg sync.WaitGroup
+		for i := 0; i < 100; i++ {
+			wg.Add(1)
+			go func() {
+				defer wg.Done()
+				_, _ = TestingArgs()
+			}()
+		}
+		wg.Wait()
+		profiles := CoverageProfiles()
+		Expect(profiles).To(HaveLen(100))
+		unique := map[string]struct{}{}
+		for _, name := range profiles {
+			unique[name] = struct{}{}
+		}
+		Expect(unique).To(HaveLen(100))
+		Expect(unique).NotTo(HaveKey(earlier[0]))
 	})
 
 })
@@ -0,0 +1,83 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"encoding/json"
+	"errors"
+	"io"
+	"os"
+	"sync"
+)
+
+// ParamReader specifies a reader to stream the parameter from into the
+// re-executed action's stdin, instead of sending a single in-memory Param.
+// The stream gets copied while the child is already running and producing
+// its result, with the pipe to the child providing backpressure, so neither
+// side needs to buffer the complete input. When the reader reaches EOF, the
+// child sees EOF on its stdin. The reader should not block indefinitely: if
+// it still blocks after the child has terminated, Run() closes the reader if
+// it is an io.Closer, stops waiting for the copy after a short grace period,
+// and returns an error.
+//
+// Typically, the reader delivers a stream of JSON values which the action
+// then decodes one by one using ParamDecoder().
+func ParamReader(r io.Reader) ReexecActionOption {
+	return func(a *ReexecAction) {
+		a.ParamReader = r
+	}
+}
+
+// ParamDecoder returns a JSON decoder for incrementally reading a streamed
+// parameter in a re-executed action: either call Decode() until it returns
+// io.EOF, or use Token() to walk through a huge JSON array element by
+// element.
+func ParamDecoder() *json.Decoder {
+	return json.NewDecoder(os.Stdin)
+}
+
+// errParamReaderBlocked reports a parameter reader that still blocked after
+// the child had terminated.
+var errParamReaderBlocked = errors.New("parameter reader still blocks after child terminated")
+
+// streamBufferPool recycles the buffers for streaming parameters.
+var streamBufferPool = sync.Pool{
+	New: func() interface{} { b := make([]byte, 32*1024); return &b },
+}
+
+// streamParam copies from the parameter reader to the child's stdin until
+// EOF, then closes the child's stdin. It returns only reader errors: when
+// writing fails, the child has gone without reading all of its input, and
+// any problems on the child's side get reported otherwise.
+func streamParam(childin *os.File, r io.Reader) error {
+	defer childin.Close()
+	bufp := streamBufferPool.Get().(*[]byte)
+	defer streamBufferPool.Put(bufp)
+	buf := *bufp
+	for {
+		n, err := r.Read(buf)
+		if n > 0 {
+			if _, werr := childin.Write(buf[:n]); werr != nil {
+				return nil
+			}
+		}
+		if err == io.EOF {
+			return nil
+		}
+		if err != nil {
+			return err
+		}
+	}
+}
@@ -0,0 +1,125 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"errors"
+	"fmt"
+	"io"
+	"os"
+	"strings"
+	"testing/iotest"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+func init() {
+	Register("sum", func() {
+		dec := ParamDecoder()
+		sum := 0
+		for {
+			var n int
+			err := dec.Decode(&n)
+			if err == io.EOF {
+				break
+			}
+			if err != nil {
+				fmt.Fprint(os.Stderr, err.Error())
+				return
+			}
+			sum += n
+		}
+		fmt.Fprintln(os.Stdout, sum)
+	})
+}
+
+var _ = Describe("streamed parameters", func() {
+
+	It("rejects Param together with ParamReader", func() {
+		Expect(func() {
+			_ = RunReexecAction("sum", Param(42), ParamReader(strings.NewReader("42")))
+		}).To(Panic())
+		Expect(func() {
+			Subscribe("watcher", ParamReader(strings.NewReader("42")))
+		}).To(Panic())
+	})
+
+	It("streams a large parameter", func() {
+		const count = 200000
+		r, w := io.Pipe()
+		go func() {
+			defer w.Close()
+			for i := 1; i <= count; i++ {
+				if _, err := fmt.Fprintln(w, i); err != nil {
+					return
+				}
+			}
+		}()
+		var sum int
+		Expect(RunReexecAction("sum", ParamReader(r), Result(&sum))).To(Succeed())
+		Expect(sum).To(Equal(count * (count + 1) / 2))
+	})
+
+	It("reports reader errors", func() {
+		Expect(RunReexecAction("sum",
+			ParamReader(iotest.TimeoutReader(strings.NewReader("1 2 3"))),
+			Result(new(int)))).To(MatchError(MatchRegexp(
+			`cannot send parameter to child, reason: timeout`)))
+	})
+
+	It("doesn't care about unread input", func() {
+		var s string
+		Expect(RunReexecAction("action",
+			ParamReader(io.LimitReader(neverending{}, 10*1024*1024)),
+			Result(&s))).To(Succeed())
+		Expect(s).To(Equal("done"))
+		Expect(errors.Is(streamParam(nil, iotest.ErrReader(io.ErrUnexpectedEOF)),
+			io.ErrUnexpectedEOF)).To(BeTrue())
+	})
+
+	It("doesn't hang on blocking readers", func() {
+		r := blockingReader(make(chan struct{}))
+		defer close(r)
+		var s string
+		Expect(RunReexecAction("action", ParamReader(r), Result(&s))).To(MatchError(
+			MatchRegexp(`cannot send parameter to child, reason: parameter reader still blocks`)))
+
+		pr, pw := io.Pipe()
+		Expect(RunReexecAction("action", ParamReader(pr), Result(&s))).To(MatchError(
+			MatchRegexp(`cannot send parameter to child, reason: parameter reader still blocks`)))
+		_, err := pw.Write([]byte("42"))
+		Expect(err).To(MatchError(io.ErrClosedPipe))
+	})
+
+})
+
+// blockingReader blocks reading until closed, but isn't an io.Closer itself.
+type blockingReader chan struct{}
+
+func (r blockingReader) Read(p []byte) (int, error) {
+	<-r
+	return 0, io.EOF
+}
+
+// neverending is an endless stream of spaces.
+type neverending struct{}
+
+func (neverending) Read(p []byte) (int, error) {
+	for idx := range p {
+		p[idx] = ' '
+	}
+	return len(p), nil
+}
@@ -0,0 +1,160 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"bytes"
+	"encoding/json"
+	"os"
+	"strings"
+	"sync"
+)
+
+// The parent side of a re-execution is on the hot path of applications
+// fanning out discoveries into lots of namespaces, so we try to recycle as
+// much of the per-call state as possible.
+
+// maxPooledBufferSize is the capacity limit of buffers we return into their
+// pools; anything larger we rather leave to the GC in order to not keep a
+// single outlier's memory around forever.
+const maxPooledBufferSize = 64 * 1024
+
+// paramEncoder is a JSON encoder writing into its own buffer. As writing to a
+// bytes.Buffer never fails, the encoder never gets into a sticky error state
+// and thus can be reused.
+type paramEncoder struct {
+	buf bytes.Buffer
+	enc *json.Encoder
+}
+
+// paramPool recycles the encoders for sending parameters to children.
+var paramPool = sync.Pool{
+	New: func() interface{} {
+		pe := &paramEncoder{}
+		pe.enc = json.NewEncoder(&pe.buf)
+		return pe
+	},
+}
+
+// putBuffer resets the specified buffer and returns it into the given pool,
+// unless it has grown too large.
+func putBuffer(pool *sync.Pool, buf *bytes.Buffer, item interface{}) {
+	if buf.Cap() > maxPooledBufferSize {
+		return
+	}
+	buf.Reset()
+	pool.Put(item)
+}
+
+// envPool recycles the environment slices of children; starting a child
+// copies the environment, so we can recycle our slice right after the child
+// has been started.
+var envPool = sync.Pool{
+	New: func() interface{} { return new([]string) },
+}
+
+// putEnv clears the specified environment slice in order to not keep the
+// strings alive and returns it into its pool.
+func putEnv(env *[]string) {
+	e := *env
+	for idx := range e {
+		e[idx] = ""
+	}
+	*env = e[:0]
+	envPool.Put(env)
+}
+
+// dedupEnv removes variables from env that are overridden by later variables
+// of the same name. As only the variables starting at index top can override
+// others, this boils down to checking against a handful of variables without
+// needing any map.
+func dedupEnv(env []string, top int) []string {
+	out := env[:0]
+	for idx, kv := range env {
+		from := idx + 1
+		if from < top {
+			from = top
+		}
+		if !definesEnv(envName(kv), env[from:]) {
+			out = append(out, kv)
+		}
+	}
+	return out
+}
+
+// definesEnv returns true if env contains a variable with the specified name.
+func definesEnv(name string, env []string) bool {
+	for _, kv := range env {
+		if len(kv) > len(name) && kv[len(name)] == '=' && kv[:len(name)] == name {
+			return true
+		}
+	}
+	return false
+}
+
+// envName returns the name part of an environment variable "name=value".
+func envName(kv string) string {
+	if eq := strings.IndexByte(kv, '='); eq >= 0 {
+		return kv[:eq]
+	}
+	return kv
+}
+
+// devNull is shared as stdin by all children not receiving any parameter, so
+// we don't need to open "/dev/null" over and over again.
+var (
+	devNull     *os.File
+	devNullOnce sync.Once
+)
+
+// sharedDevNull returns the shared "/dev/null" file, or nil if it cannot be
+// opened, in which case the child is started with a closed stdin.
+func sharedDevNull() *os.File {
+	devNullOnce.Do(func() {
+		devNull, _ = os.Open(os.DevNull)
+	})
+	return devNull
+}
+
+// namespaceEnviron returns the "gons_*" environment variables telling a child
+// to switch into the specified namespaces, including the "gons_order" with the
+// sequence of namespace switches.
+func namespaceEnviron(namespaces []Namespace) []string {
+	env := make([]string, 0, len(namespaces)+1)
+	var ooorder strings.Builder // cSpell:ignore ooorder
+	ooorder.WriteString("gons_order=")
+	for idx, ns := range namespaces {
+		if idx > 0 {
+			ooorder.WriteByte(',')
+		}
+		ooorder.WriteString(ns.Type)
+		env = append(env, "gons_"+strings.TrimPrefix(ns.Type, "!")+"="+ns.Path)
+	}
+	return append(env, ooorder.String())
+}
+
+// sameNamespaces returns true if both slices contain the same namespaces in
+// the same order.
+func sameNamespaces(a, b []Namespace) bool {
+	if len(a) != len(b) {
+		return false
+	}
+	for idx := range a {
+		if a[idx] != b[idx] {
+			return false
+		}
+	}
+	return true
+}
@@ -0,0 +1,192 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"context"
+	"os"
+	"path/filepath"
+	"runtime"
+	"runtime/pprof"
+	"strconv"
+	"strings"
+	"sync"
+
+	"github.com/thediveo/gons/reexec/internal/testsupport"
+)
+
+// Environment variables telling a re-executed child the file descriptors to
+// write its CPU and heap profiles to.
+const (
+	cpuProfileEnvVar  = "gons_reexec_cpuprofile"
+	heapProfileEnvVar = "gons_reexec_heapprofile"
+)
+
+// ActionProfileLabel is the pprof label key whose value is the name of the
+// action that was running in a re-executed child when a CPU profile sample
+// was taken.
+const ActionProfileLabel = "gons_reexec_action"
+
+// ChildProfiling configures the CPU and heap profiling of re-executed
+// children, as otherwise any work done inside the children would be
+// invisible to profiling. Each child writes its profiles to separate files,
+// named after the specified paths with the child's action name (with slashes
+// replaced by underscores) and PID appended, such as
+// "cpu.pprof.myaction.1234". The parent creates the profile files, so the
+// paths always refer to the parent's filesystem view, even for children
+// switching into other mount namespaces. Go's pprof tool happily merges
+// multiple profiles given on its command line, such as in "go tool pprof
+// cpu.pprof cpu.pprof.*", and CPU profile samples from the children carry
+// the ActionProfileLabel. Under test, gons/reexec/testing.M instead merges
+// the children's profiles into the "-test.cpuprofile" and "-test.memprofile"
+// profiles of the test process.
+//
+// Please note that children can only write their profiles when their actions
+// return, instead of calling os.Exit themselves.
+type ChildProfiling struct {
+	CPUProfile  string // path prefix of child CPU profiles; empty disables CPU profiling.
+	HeapProfile string // path prefix of child heap profiles; empty disables heap profiling.
+}
+
+var (
+	childProfiling   ChildProfiling
+	childProfilingMu sync.Mutex
+)
+
+// SetChildProfiling sets the process-wide CPU and heap profiling of
+// re-executed children; the zero value disables child profiling. Under test,
+// gons/reexec/testing.M automatically enables child profiling when running
+// with "-test.cpuprofile" and/or "-test.memprofile".
+func SetChildProfiling(p ChildProfiling) {
+	childProfilingMu.Lock()
+	defer childProfilingMu.Unlock()
+	childProfiling = p
+}
+
+// childProfile is a profile file created by the parent for a single
+// re-executed child. Creating the file in the parent instead of the child
+// ensures that the profile path refers to the parent's filesystem view, as
+// the child might already have switched into a different mount namespace
+// when it gets to profiling.
+type childProfile struct {
+	env    string   // tells the child the fd number of its profile file.
+	name   string   // final profile file name, still lacking the child's PID.
+	file   *os.File // temporary profile file, to be named after the child.
+	merged string   // under test, path prefix to record the profile file for.
+}
+
+// openChildProfiles creates the profile files for a child to be re-executed
+// into the named action, if child profiling is enabled. The child receives
+// the profile files as its file descriptors, starting with the specified fd
+// number. As profiling is only a nice-to-have, profile files that cannot be
+// created are silently skipped.
+func openChildProfiles(actionname string, fd int) []childProfile {
+	childProfilingMu.Lock()
+	p := childProfiling
+	childProfilingMu.Unlock()
+	undertest := false
+	if p == (ChildProfiling{}) && testsupport.TestingEnabled {
+		p.CPUProfile = testsupport.ChildCPUProfile
+		p.HeapProfile = testsupport.ChildHeapProfile
+		undertest = true
+	}
+	if p == (ChildProfiling{}) {
+		return nil
+	}
+	suffix := "." + strings.ReplaceAll(actionname, "/", "_") + "."
+	var profs []childProfile
+	for _, prof := range [...]struct{ envvar, path string }{
+		{envvar: cpuProfileEnvVar, path: p.CPUProfile},
+		{envvar: heapProfileEnvVar, path: p.HeapProfile},
+	} {
+		if prof.path == "" {
+			continue
+		}
+		f, err := os.CreateTemp(filepath.Dir(prof.path), filepath.Base(prof.path)+suffix+"tmp*")
+		if err != nil {
+			continue
+		}
+		merged := ""
+		if undertest {
+			merged = prof.path
+		}
+		profs = append(profs, childProfile{
+			env:    prof.envvar + "=" + strconv.Itoa(fd+len(profs)),
+			name:   prof.path + suffix,
+			file:   f,
+			merged: merged,
+		})
+	}
+	return profs
+}
+
+// closeChildProfiles closes our copies of the specified child profile files
+// and names them after the PID of the child; under test, it records them for
+// merging into the parent's profiles. If the child never got started, as
+// signalled by a zero PID, or didn't write a profile, such as when exiting
+// inside its action, then the profile files are removed instead.
+func closeChildProfiles(profs []childProfile, pid int) {
+	for _, prof := range profs {
+		info, err := prof.file.Stat()
+		_ = prof.file.Close()
+		if pid == 0 || err == nil && info.Size() == 0 {
+			_ = os.Remove(prof.file.Name())
+			continue
+		}
+		name := prof.name + strconv.Itoa(pid)
+		if os.Rename(prof.file.Name(), name) == nil && prof.merged != "" {
+			testsupport.AddChildProfile(prof.merged, name)
+		}
+	}
+}
+
+// runProfiled runs the specified action inside a re-executed child, profiling
+// it if asked to do so by our parent. As profiling is only a nice-to-have,
+// any problems with profile files are silently ignored, because anything
+// written to stderr would fail the re-execution.
+func runProfiled(actionname string, action Action) {
+	cpuprofile := inheritedProfile(cpuProfileEnvVar)
+	heapprofile := inheritedProfile(heapProfileEnvVar)
+	if cpuprofile == nil && heapprofile == nil {
+		action()
+		return
+	}
+	if cpuprofile != nil {
+		defer cpuprofile.Close()
+		if pprof.StartCPUProfile(cpuprofile) == nil {
+			defer pprof.StopCPUProfile()
+		}
+	}
+	pprof.Do(context.Background(), pprof.Labels(ActionProfileLabel, actionname),
+		func(context.Context) { action() })
+	if heapprofile != nil {
+		defer heapprofile.Close()
+		runtime.GC() // get up-to-date statistics, as testing does.
+		// Write the same profile as testing's "-test.memprofile" does, so
+		// that the profiles can be merged.
+		_ = pprof.Lookup("allocs").WriteTo(heapprofile, 0)
+	}
+}
+
+// inheritedProfile returns the profile file passed to us by our parent as
+// the file descriptor named in the specified environment variable, or nil if
+// there is none.
+func inheritedProfile(envvar string) *os.File {
+	fd, err := strconv.Atoi(os.Getenv(envvar))
+	if err != nil || fd <= 2 {
+		return nil
+	}
+	return os.NewFile(uintptr(fd), envvar)
+}
@@ -0,0 +1,121 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"bytes"
+	"compress/gzip"
+	"io"
+	"os"
+	"path/filepath"
+	"time"
+
+	"github.com/thediveo/gons/reexec/internal/testsupport"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+func init() {
+	Register("gons/busy", func() {
+		// Burn some CPU cycles, so the CPU profile gets samples.
+		for start := time.Now(); time.Since(start) < 250*time.Millisecond; {
+		}
+		_ = Reply("done")
+	})
+}
+
+// unzipped returns the uncompressed contents of the specified pprof profile
+// file.
+func unzipped(path string) []byte {
+	f, err := os.Open(path)
+	ExpectWithOffset(1, err).NotTo(HaveOccurred())
+	defer f.Close()
+	r, err := gzip.NewReader(f)
+	ExpectWithOffset(1, err).NotTo(HaveOccurred())
+	data, err := io.ReadAll(r)
+	ExpectWithOffset(1, err).NotTo(HaveOccurred())
+	return data
+}
+
+var _ = Describe("child profiling", func() {
+
+	It("doesn't profile children by default", func() {
+		// Running our tests with -test.cpuprofile or -test.memprofile
+		// automatically enables child profiling, so make sure to get the
+		// true default.
+		cpuprofile, heapprofile := testsupport.ChildCPUProfile, testsupport.ChildHeapProfile
+		testsupport.ChildCPUProfile, testsupport.ChildHeapProfile = "", ""
+		defer func() {
+			testsupport.ChildCPUProfile, testsupport.ChildHeapProfile = cpuprofile, heapprofile
+		}()
+		Expect(openChildProfiles("gons/busy", 3)).To(BeEmpty())
+	})
+
+	It("profiles children with action labels", func() {
+		tmpdir, err := os.MkdirTemp("", "childprof-*")
+		Expect(err).NotTo(HaveOccurred())
+		defer os.RemoveAll(tmpdir)
+		SetChildProfiling(ChildProfiling{
+			CPUProfile:  filepath.Join(tmpdir, "cpu.pprof"),
+			HeapProfile: filepath.Join(tmpdir, "heap.pprof"),
+		})
+		defer SetChildProfiling(ChildProfiling{})
+
+		var s string
+		Expect(RunReexecAction("gons/busy", Result(&s))).To(Succeed())
+		Expect(s).To(Equal("done"))
+
+		cpuprofs, _ := filepath.Glob(filepath.Join(tmpdir, "cpu.pprof.gons_busy.*"))
+		Expect(cpuprofs).To(HaveLen(1))
+		cpuprof := unzipped(cpuprofs[0])
+		Expect(bytes.Contains(cpuprof, []byte(ActionProfileLabel))).To(BeTrue())
+		Expect(bytes.Contains(cpuprof, []byte("gons/busy"))).To(BeTrue())
+
+		heapprofs, _ := filepath.Glob(filepath.Join(tmpdir, "heap.pprof.gons_busy.*"))
+		Expect(heapprofs).To(HaveLen(1))
+		Expect(unzipped(heapprofs[0])).NotTo(BeEmpty())
+
+		leftovers, _ := filepath.Glob(filepath.Join(tmpdir, "*.tmp*"))
+		Expect(leftovers).To(BeEmpty())
+	})
+
+	It("records children's profiles for merging when under test", func() {
+		if !testsupport.TestingEnabled {
+			Skip("only under test")
+		}
+		tmpdir, err := os.MkdirTemp("", "childprof-*")
+		Expect(err).NotTo(HaveOccurred())
+		defer os.RemoveAll(tmpdir)
+		cpuprofile, heapprofile := testsupport.ChildCPUProfile, testsupport.ChildHeapProfile
+		testsupport.ChildCPUProfile = filepath.Join(tmpdir, "cpu.out")
+		testsupport.ChildHeapProfile = filepath.Join(tmpdir, "mem.out")
+		defer func() {
+			testsupport.ChildCPUProfile, testsupport.ChildHeapProfile = cpuprofile, heapprofile
+		}()
+
+		var s string
+		Expect(RunReexecAction("gons/busy", Result(&s))).To(Succeed())
+
+		for _, prefix := range []string{
+			testsupport.ChildCPUProfile, testsupport.ChildHeapProfile,
+		} {
+			profs, _ := filepath.Glob(prefix + ".gons_busy.*")
+			Expect(profs).To(HaveLen(1))
+			Expect(testsupport.ChildProfiles(prefix)).To(ConsistOf(profs[0]))
+		}
+	})
+
+})
@@ -0,0 +1,136 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"fmt"
+	"strings"
+	"syscall"
+)
+
+// nsGetNstype is the NS_GET_NSTYPE ioctl request, see ioctl_ns(2); it is
+// _IO(0xb7, 0x3).
+const nsGetNstype = 0xb7<<8 | 0x3
+
+// nstypes maps the namespace type names used in Namespace.Type to their
+// corresponding CLONE_NEWxxx constants.
+var nstypes = map[string]uintptr{
+	"cgroup": syscall.CLONE_NEWCGROUP,
+	"ipc":    syscall.CLONE_NEWIPC,
+	"mnt":    syscall.CLONE_NEWNS,
+	"net":    syscall.CLONE_NEWNET,
+	"pid":    syscall.CLONE_NEWPID,
+	"user":   syscall.CLONE_NEWUSER,
+	"uts":    syscall.CLONE_NEWUTS,
+}
+
+// nstypeName returns the type name of a CLONE_NEWxxx namespace type constant.
+func nstypeName(nstype uintptr) string {
+	for name, t := range nstypes {
+		if t == nstype {
+			return name
+		}
+	}
+	return fmt.Sprintf("unknown (%#x)", nstype)
+}
+
+// NamespaceError reports a namespace reference that turned out to be invalid
+// when preflighting it in the parent, so no child was re-executed.
+type NamespaceError struct {
+	Namespace Namespace // the offending namespace reference.
+	Err       error     // reason for the reference being invalid.
+}
+
+// Error returns a description of the invalid namespace reference.
+func (e *NamespaceError) Error() string {
+	return fmt.Sprintf(
+		"gons/reexec: ReexecAction.Run: invalid %s namespace reference %q: %s",
+		strings.TrimPrefix(e.Namespace.Type, "!"), e.Namespace.Path, e.Err.Error())
+}
+
+// Unwrap returns the reason for the namespace reference being invalid.
+func (e *NamespaceError) Unwrap() error { return e.Err }
+
+// Preflight enables checking the namespace references in the parent before
+// re-executing, failing fast with a *NamespaceError instead of wasting a
+// process spawn on, for instance, a container that has already exited.
+//
+// Please note that namespace paths without a "!" in their type that come
+// after a mount namespace switch are resolved by the child in that other
+// mount namespace and thus cannot be checked in advance.
+func Preflight() ReexecActionOption {
+	return func(a *ReexecAction) {
+		a.Preflight = true
+	}
+}
+
+// parentContext returns a function to be called for each namespace
+// reference in sequence, reporting whether the child will resolve its path in
+// the parent's initial mount namespace context. This is the case for "!"
+// references, as well as for all references up to and including the first
+// mount namespace switch.
+func parentContext() func(ns Namespace) bool {
+	mntswitched := false
+	return func(ns Namespace) bool {
+		typename := strings.TrimPrefix(ns.Type, "!")
+		inparent := !mntswitched || typename != ns.Type
+		if typename == "mnt" {
+			mntswitched = true
+		}
+		return inparent
+	}
+}
+
+// preflight checks that the namespaces can be opened and that their types
+// match, as far as this can be checked in the parent.
+func preflight(namespaces []Namespace) error {
+	inparent := parentContext()
+	for _, ns := range namespaces {
+		typename := strings.TrimPrefix(ns.Type, "!")
+		nstype, ok := nstypes[typename]
+		if !ok {
+			return &NamespaceError{
+				Namespace: ns,
+				Err:       fmt.Errorf("unknown namespace type %q", typename),
+			}
+		}
+		// Without a bang, the child resolves the path only right before
+		// switching into this namespace, so after any earlier mount
+		// namespace switch we cannot check the path anymore.
+		if !inparent(ns) {
+			continue
+		}
+		fd, err := syscall.Open(ns.Path, syscall.O_RDONLY|syscall.O_CLOEXEC, 0)
+		if err != nil {
+			return &NamespaceError{Namespace: ns, Err: err}
+		}
+		actualtype, _, errno := syscall.Syscall(
+			syscall.SYS_IOCTL, uintptr(fd), nsGetNstype, 0)
+		syscall.Close(fd)
+		if errno != 0 {
+			if errno == syscall.ENOTTY {
+				return &NamespaceError{Namespace: ns, Err: fmt.Errorf("not a namespace")}
+			}
+			return &NamespaceError{Namespace: ns, Err: errno}
+		}
+		if actualtype != nstype {
+			return &NamespaceError{
+				Namespace: ns,
+				Err:       fmt.Errorf("is a %s namespace", nstypeName(actualtype)),
+			}
+		}
+	}
+	return nil
+}
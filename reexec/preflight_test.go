@@ -0,0 +1,75 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"errors"
+	"os"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+var _ = Describe("namespace preflight", func() {
+
+	It("accepts valid namespace references", func() {
+		Expect(preflight(nil)).To(Succeed())
+		Expect(preflight([]Namespace{
+			{Type: "!net", Path: "/proc/self/ns/net"},
+			{Type: "ipc", Path: "/proc/self/ns/ipc"},
+		})).To(Succeed())
+	})
+
+	It("rejects invalid namespace references", func() {
+		err := preflight([]Namespace{{Type: "net", Path: "/nonexisting"}})
+		var nserr *NamespaceError
+		Expect(errors.As(err, &nserr)).To(BeTrue())
+		Expect(nserr.Namespace.Path).To(Equal("/nonexisting"))
+		Expect(errors.Is(err, os.ErrNotExist)).To(BeTrue())
+
+		Expect(preflight([]Namespace{{Type: "foo", Path: "/proc/self/ns/net"}})).To(
+			MatchError(MatchRegexp(`unknown namespace type "foo"`)))
+		Expect(preflight([]Namespace{{Type: "net", Path: "/proc/self/status"}})).To(
+			MatchError(MatchRegexp(`invalid net namespace reference .*: not a namespace`)))
+		Expect(preflight([]Namespace{{Type: "!net", Path: "/proc/self/ns/ipc"}})).To(
+			MatchError(MatchRegexp(`invalid net namespace reference .*: is a ipc namespace`)))
+	})
+
+	It("skips references resolved after a mount namespace switch", func() {
+		Expect(preflight([]Namespace{
+			{Type: "mnt", Path: "/proc/self/ns/mnt"},
+			{Type: "net", Path: "/nonexisting"},
+		})).To(Succeed())
+		Expect(preflight([]Namespace{
+			{Type: "mnt", Path: "/proc/self/ns/mnt"},
+			{Type: "!net", Path: "/nonexisting"},
+		})).NotTo(Succeed())
+	})
+
+	It("fails fast without re-executing", func() {
+		var s string
+		Expect(RunReexecAction("action",
+			Namespaces([]Namespace{{Type: "net", Path: "/nonexisting"}}),
+			Preflight(),
+			Result(&s))).To(MatchError(MatchRegexp(`invalid net namespace reference`)))
+		Expect(s).To(BeEmpty())
+		Expect(RunReexecAction("action",
+			Namespaces([]Namespace{{Type: "net", Path: "/proc/self/ns/net"}}),
+			Preflight(),
+			Result(&s))).To(Succeed())
+		Expect(s).To(Equal("done"))
+	})
+
+})
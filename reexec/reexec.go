@@ -18,13 +18,15 @@
 package reexec
 
 import (
-	"bytes"
 	"encoding/json"
+	"errors"
 	"fmt"
 	"io"
 	"os"
 	"os/exec"
 	"strings"
+	"sync"
+	"sync/atomic"
 	"time"
 
 	"github.com/thediveo/gons"
@@ -52,7 +54,8 @@ const magicEnvVar = "gons_reexec_action"
 // function that needs fork/re-execution, but which have not called
 // CheckAction() will panic instead of forking and re-executing themselves.
 // This is a safeguard measure to cause havoc by unexpected clone restarts.
-var reexecEnabled = false
+// As Run() checks this flag from any number of go routines, it is atomic.
+var reexecEnabled atomic.Bool
 
 // CheckAction checks if an application using reexec has been forked and
 // re-executed in order to switch namespaces in the clone. If we're in a
@@ -65,6 +68,26 @@ func CheckAction() {
 	}
 }
 
+// namespaceSwitchFailure prefixes the panic message of a child that failed to
+// switch into its namespaces, so that its parent can tell namespace problems
+// apart from problems of the action itself.
+const namespaceSwitchFailure = "gons/reexec: cannot switch namespaces: "
+
+// schedulingFailure prefixes the panic message of a child that failed to
+// apply its scheduling settings. Such failures are caused by the settings
+// instead of the target namespaces, so they don't count against the latter.
+const schedulingFailure = "gons/reexec: cannot apply scheduling settings: "
+
+// killGracePeriod is the time a child gets to terminate on its own after we
+// got its result, before we kill it.
+const killGracePeriod = 1 * time.Second
+
+// selfExe references our own executable for re-execution, and selfArgv is the
+// argument vector for re-executing it when not under test.
+const selfExe = "/proc/self/exe"
+
+var selfArgv = []string{selfExe}
+
 // For the sake of code coverage ;)
 var osExit = os.Exit
 
@@ -76,22 +99,26 @@ var osExit = os.Exit
 func RunAction() (action bool) {
 	// Did we had a problem during reentry...?
 	if err := gons.Status(); err != nil {
-		panic(err)
+		var schederr *gons.SchedulingError
+		if errors.As(err, &schederr) {
+			panic(schedulingFailure + err.Error())
+		}
+		panic(namespaceSwitchFailure + err.Error())
 	}
 	if actionname := os.Getenv(magicEnvVar); actionname != "" {
 		// Only run the requested action, and then exit. The caller will never
 		// gain back control in this case.
-		action, ok := actions[actionname]
+		action, ok := lookupAction(actionname)
 		if !ok {
 			panic(fmt.Sprintf(
 				"unregistered gons/reexec re-execution action %q", actionname))
 		}
-		action()
+		runProfiled(actionname, action)
 		return true
 	}
 	// Enable fork/re-execution only for the parent process of the application
 	// using reexec, but not in the re-executed child.
-	reexecEnabled = true
+	reexecEnabled.Store(true)
 	return
 }
 
@@ -102,19 +129,45 @@ func RunAction() (action bool) {
 // without a bang, the path will be opened only right when this namespace
 // should be switched. Thus, the path will depend on the current set of
 // namespaces, not the initial set when calling ForkReexec().
-type Namespace struct {
-	Type string // namespace type, such as "net", "mnt", ...
-	Path string // path reference to namespace in filesystem.
-}
+//
+// Namespace is defined in an internal package, so that gons/reexec/testing
+// can accept namespaces without importing us.
+type Namespace = testsupport.Namespace
 
 // ReexecAction describes a named action to be re-executed in a forked child
 // copy of this process, together with its mandatory parameters and options.
 type ReexecAction struct {
-	ActionName  string      // name of action to run in re-executed child.
-	Namespaces  []Namespace // namespaces to switch into before executing action.
-	Param       interface{} // optional parameter to be sent to the action.
-	Result      interface{} // where to put the action result to.
-	Environment []string    // optional environment variables to pass to re-executed child.
+	ActionName  string         // name of action to run in re-executed child.
+	Namespaces  []Namespace    // namespaces to switch into before executing action.
+	Param       interface{}    // optional parameter to be sent to the action.
+	ParamReader io.Reader      // optional parameter stream to be sent to the action.
+	Result      interface{}    // where to put the action result to.
+	Environment []string       // optional environment variables to pass to re-executed child.
+	Runtime     RuntimeProfile // optional Go runtime tuning of the re-executed child.
+	EnvTemplate *EnvTemplate   // optional base environment instead of this process' environment.
+	StderrLimit int            // max. stderr bytes kept; 0 is DefaultStderrLimit, negative is unlimited.
+	Preflight   bool           // check namespace references in the parent before re-executing.
+
+	FailureTracker *FailureTracker // optional circuit breaker for repeatedly failing namespaces.
+	Priority       Priority        // priority when waiting for admission.
+	Cgroup         string          // optional cgroup v2 directory to start the child in.
+	Scheduling     Scheduling      // optional CPU affinity, scheduling and I/O priority.
+	ResultCache    *ResultCache    // optional cache to skip unchanged results.
+	Helper         string          // optional helper executable to run instead of ourselves.
+
+	// Preformatted environment variables, as long as they still correspond
+	// with the Namespaces and Runtime fields.
+	nsenv   []string
+	nsenvOf []Namespace
+	rtenv   []string
+	rtenvOf RuntimeProfile
+	// Preformatted helper argument vector, as long as it still corresponds
+	// with the Helper field.
+	helperArgv []string
+
+	// Optionally decodes a stream of results instead of a single result,
+	// with the child's stdin kept open until the streamer is done.
+	streamer func(dec *json.Decoder, childin, childout *os.File) error
 }
 
 // ReexecActionOption is an option function configuring some aspect of a
@@ -144,8 +197,15 @@ func RunReexecAction(actionname string, options ...ReexecActionOption) error {
 // Namespaces specifies the namespaces an (re-executed) named action is to be
 // run in.
 func Namespaces(namespaces []Namespace) ReexecActionOption {
+	// Preformat the environment variables only once, so callers reusing this
+	// option don't pay for it over and over again. As callers might modify
+	// their namespaces slice in place later, we keep our own copy of it to
+	// check the preformatted variables against.
+	nsenv := namespaceEnviron(namespaces)
+	nsenvOf := append([]Namespace(nil), namespaces...)
 	return func(a *ReexecAction) {
 		a.Namespaces = namespaces
+		a.nsenv, a.nsenvOf = nsenv, nsenvOf
 	}
 }
 
@@ -179,10 +239,30 @@ func Environment(environment []string) ReexecActionOption {
 // output of the child gets deserialized as JSON into the passed result element.
 // The call only returns after the child process has terminated.
 func (a *ReexecAction) Run() (err error) {
+	a.mustBeRunnable()
+	// Don't waste process spawns on namespaces that failed us repeatedly in
+	// the recent past.
+	var target string
+	if a.FailureTracker != nil {
+		target = namespacesTarget(a.Namespaces)
+		if err := a.FailureTracker.admit(target); err != nil {
+			return err
+		}
+	}
+	targetfailed, err := a.run()
+	if a.FailureTracker != nil {
+		a.FailureTracker.record(target, targetfailed)
+	}
+	return err
+}
+
+// mustBeRunnable panics if this action cannot be re-executed at all, as the
+// application isn't prepared for it or the action isn't registered.
+func (a *ReexecAction) mustBeRunnable() {
 	// Safeguard against applications trying to run more elaborate discoveries
 	// and are forgetting to enable the required re-execution of themselves by
 	// calling CheckAction() very early in their runtime live.
-	if !reexecEnabled {
+	if !reexecEnabled.Load() {
 		if actionname := os.Getenv(magicEnvVar); actionname == "" {
 			panic("gons/reexec: ReexecAction.Run: application does not support " +
 				"forking and restarting, needs to call reexec.CheckAction() " +
@@ -191,10 +271,31 @@ func (a *ReexecAction) Run() (err error) {
 		panic("gons/reexec: ReexecAction.Run: tried to re-execute in " +
 			"already re-executing child process")
 	}
-	if _, ok := actions[a.ActionName]; !ok {
+	// We can only check the registration of actions run by re-executing
+	// ourselves; a helper might well serve actions we don't know of.
+	if _, ok := lookupAction(a.ActionName); !ok && a.helper() == nil {
 		panic("gons/reexec: ReexecAction.Run: attempting to re-execute into " +
 			"unregistered action \"" + a.ActionName + "\"")
 	}
+}
+
+// run does the real re-execution work, additionally reporting whether the
+// target namespaces failed us: because the child couldn't be started, failed
+// to switch into its namespaces, or had to be killed as it didn't terminate
+// in time. Errors of the action itself, such as stderr output or a result
+// that cannot be decoded, don't count as failures of the target namespaces.
+func (a *ReexecAction) run() (targetfailed bool, err error) {
+	// Optionally fail fast on stale or otherwise invalid namespace references
+	// before spending a process spawn on them.
+	if a.Preflight {
+		if err := preflight(a.Namespaces); err != nil {
+			return true, err
+		}
+	}
+	// Wait for admission subject to the process-wide limits, then count as
+	// running until our child has terminated.
+	admission.acquire(a.Priority)
+	defer admission.release()
 	// If testing has been enabled, then make sure to pass the necessary
 	// parameters on to our child processes, as it will (have to) use a
 	// TestMain and our "enhanced" gons.reexec.testing.M.
@@ -205,118 +306,265 @@ func (a *ReexecAction) Run() (err error) {
 	// this avoids the same tests getting run multiple times ... and
 	// eventually panicking when trying to re-execute again.
 	//
-	// If coverage propfiling is enabled, then for each child we allocate a
-	// separate child coverage profile data file, which we will have to merge
-	// later with our main coverage profile of this process.
-	testargs := testsupport.TestingArgs()
-	// Prepare a fork/re-execution of ourselves, which then switches itself
-	// into the required namespace(s) before its Go runtime spins up.
-	forkchild := exec.Command("/proc/self/exe", testargs...)
-	forkchild.Env = append(os.Environ(), a.Environment...)
+	// If coverage propfiling is enabled, then each child either hands off
+	// its coverage profile data through a pipe passed as its fd 3, or we
+	// allocate a separate child coverage profile data file, which we will
+	// have to merge later with our main coverage profile of this process.
+	//
+	// A helper executable isn't our test binary, so it neither gets any
+	// testing-related arguments nor can it take part in coverage profiling.
+	exe, argv := selfExe, selfArgv
+	var coverfile *os.File
+	if helperargv := a.helper(); helperargv != nil {
+		exe, argv = helperargv[0], helperargv
+	} else {
+		var testargs []string
+		testargs, coverfile = testsupport.TestingArgs()
+		if coverfile != nil {
+			defer coverfile.Close()
+		}
+		if len(testargs) != 0 {
+			argv = append(append(make([]string, 0, 1+len(testargs)), selfExe), testargs...)
+		}
+	}
+	// When profiling children, we create their profile files here in the
+	// parent and pass them as additional file descriptors following stdin,
+	// stdout, stderr, and the coverage profile data pipe, if any.
+	profilefd := 3
+	if coverfile != nil {
+		profilefd++
+	}
+	profiles := openChildProfiles(a.ActionName, profilefd)
+	childpid := 0
+	if profiles != nil {
+		defer func() { closeChildProfiles(profiles, childpid) }()
+	}
+	// The child's environment is either based on our full environment, or on
+	// a precomputed and usually much more compact template. As the complete
+	// environment gets copied again when starting the child as well as by the
+	// kernel, we recycle our environment slices and use preformatted
+	// variables where possible.
+	var base []string
+	if a.EnvTemplate != nil {
+		base = a.EnvTemplate.env
+	} else {
+		base = os.Environ()
+	}
+	rtenv := a.rtenv
+	if a.rtenvOf != a.Runtime {
+		rtenv = a.Runtime.environ()
+	}
 	// Pass the namespaces the fork/child should switch into via the
 	// soon-to-be child's environment. The sequence of the namespaces slice is
 	// kept, so that the caller has control of the exact sequence of namespace
 	// switches.
-	ooorder := []string{} // cSpell:ignore ooorder
-	for _, ns := range a.Namespaces {
-		ooorder = append(ooorder, ns.Type)
-		forkchild.Env = append(forkchild.Env,
-			fmt.Sprintf("gons_%s=%s", strings.TrimPrefix(ns.Type, "!"), ns.Path))
-	}
-	forkchild.Env = append(forkchild.Env, "gons_order="+strings.Join(ooorder, ","))
-	// Finally set the action to run on restarting our fork, and then try to
-	// start our re-executed fork child...
-	forkchild.Env = append(forkchild.Env, magicEnvVar+"="+a.ActionName)
-	// If necessary, prepare a JSON encode to send input data to the child
-	// process via the child's stdin.
-	var encoder *json.Encoder
-	if a.Param != nil {
-		childin, err := forkchild.StdinPipe()
-		if err != nil {
+	nsenv := a.nsenv
+	if nsenv == nil || !sameNamespaces(a.nsenvOf, a.Namespaces) {
+		nsenv = namespaceEnviron(a.Namespaces)
+	}
+	envp := envPool.Get().(*[]string)
+	defer putEnv(envp)
+	env := append(*envp, base...)
+	env = append(env, rtenv...)
+	env = append(env, a.Scheduling.environ()...)
+	for _, prof := range profiles {
+		env = append(env, prof.env)
+	}
+	env = append(env, a.Environment...)
+	env = append(env, nsenv...)
+	// Tell a caching-aware child which result we've already seen.
+	if a.ResultCache != nil {
+		env = append(env, digestEnvVar+"="+a.ResultCache.Digest())
+	}
+	// Finally set the action to run on restarting our fork...
+	env = append(env, actionEnviron(a.ActionName))
+	env = dedupEnv(env, len(base))
+	*envp = env
+	// If necessary, prepare a pipe to send input data to the child process via
+	// the child's stdin; otherwise, the child gets our shared /dev/null.
+	// Then prepare the pipes for the child's stdout and stderr. We start the
+	// child directly instead of going through exec.Cmd, as this saves quite
+	// some allocations and a go routine per child.
+	stdin := sharedDevNull()
+	var childin *os.File
+	if a.Param != nil && a.ParamReader != nil {
+		panic("gons/reexec: ReexecAction.Run: cannot send both Param and ParamReader")
+	}
+	if a.Param != nil || a.ParamReader != nil || a.streamer != nil {
+		if stdin, childin, err = os.Pipe(); err != nil {
 			panic(fmt.Sprintf(
 				"gons/reexec: ReexecAction.Run: cannot prepare for restarting my fork, reason: %s",
 				err.Error()))
 		}
 		defer childin.Close()
-		encoder = json.NewEncoder(childin)
+		defer stdin.Close()
 	}
-	// Get the stdout pipe from the child.
-	childout, err := forkchild.StdoutPipe()
+	childout, outw, err := os.Pipe()
 	if err != nil {
 		panic(fmt.Sprintf(
 			"gons/reexec: ReexecAction.Run: cannot prepare for restarting my fork, reason: %s",
 			err.Error()))
 	}
 	defer childout.Close()
-	// Get the stderr pipe from the child and collect any data we might receive.
-	// Unfortunately, we can't use the buffer writer directly without further
-	// measures as this creates a race condition in those situations where we
-	// need to kill the child process: we need to know when the stderr pipe has
-	// been closed.
-	var childerr bytes.Buffer
-	errpipe, err := forkchild.StderrPipe()
+	defer outw.Close()
+	errpipe, errw, err := os.Pipe()
 	if err != nil {
 		panic(fmt.Sprintf(
 			"gons/reexec: ReexecAction.Run: cannot prepare for restarting my fork, reason: %s",
 			err.Error()))
 	}
-	errdone := make(chan struct{}, 1)
+	defer errpipe.Close()
+	defer errw.Close()
+	// ...and then try to start our re-executed fork child, optionally right
+	// inside a different cgroup. As the cgroup might have vanished in the
+	// meantime, we report cgroup-related problems as errors instead of
+	// panicking.
+	sys, closecgroup, err := cgroupAttr(a.Cgroup)
+	if err != nil {
+		return true, err
+	}
+	files := []*os.File{stdin, outw, errw}
+	if coverfile != nil {
+		files = append(files, coverfile)
+	}
+	for _, prof := range profiles {
+		files = append(files, prof.file)
+	}
+	forkchild, err := os.StartProcess(exe, argv, &os.ProcAttr{
+		Env:   env,
+		Files: files,
+		Sys:   sys,
+	})
+	closecgroup()
+	if err != nil {
+		if sys != nil {
+			return true, fmt.Errorf(
+				"gons/reexec: ReexecAction.Run: cannot restart a fork of myself in cgroup %q, reason: %w",
+				a.Cgroup, err)
+		}
+		// Helpers are separate executables which might have gone missing,
+		// similar to vanished cgroups.
+		if exe != selfExe {
+			return true, fmt.Errorf(
+				"gons/reexec: ReexecAction.Run: cannot start helper %q, reason: %w",
+				exe, err)
+		}
+		panic("gons/reexec: ReexecAction.Run: cannot restart a fork of myself")
+	}
+	childpid = forkchild.Pid
+	// Close our copies of the child's ends of the pipes, as otherwise we would
+	// never see EOF on the child's stdout and stderr.
+	_ = outw.Close()
+	_ = errw.Close()
+	if coverfile != nil {
+		_ = coverfile.Close()
+	}
+	if childin != nil {
+		_ = stdin.Close()
+	}
+	// Collect any data we might receive from the child's stderr until the
+	// child and thus its end of the stderr pipe are gone. In order to not
+	// balloon our memory when children log excessively or dump huge stack
+	// traces, we keep only the head and tail of the stderr output.
+	childerr := newHeadTailBuffer(a.StderrLimit)
+	defer childerr.release()
+	errdone := make(chan struct{})
 	go func() {
 		defer close(errdone)
-		io.Copy(&childerr, errpipe)
+		_, _ = childerr.ReadFrom(errpipe)
 	}()
-	decoder := json.NewDecoder(childout)
-	if err := forkchild.Start(); err != nil {
-		panic("gons/reexec: ReexecAction.Run: cannot restart a fork of myself")
-	}
 	// Sent the optional parameter, if any...
 	var encodererr error
-	if encoder != nil {
-		encodererr = encoder.Encode(a.Param)
+	if a.Param != nil {
+		pe := paramPool.Get().(*paramEncoder)
+		if encodererr = pe.enc.Encode(a.Param); encodererr == nil {
+			_, encodererr = childin.Write(pe.buf.Bytes())
+		}
+		putBuffer(&paramPool, &pe.buf, pe)
+	}
+	// ...or start streaming the parameter while the child is already working
+	// on it and might be producing results even before all input is in.
+	var streamdone chan error
+	if a.ParamReader != nil {
+		streamdone = make(chan error, 1)
+		go func() {
+			streamdone <- streamParam(childin, a.ParamReader)
+		}()
 	}
 	// Decode the result as it flows in. Keep any error for later. Skip this
 	// step if we had an encoder error already, as the action won't have got its
 	// paremeters correctly.
 	var decodererr error
 	if encodererr == nil {
-		decodererr = decoder.Decode(a.Result)
+		if a.streamer != nil {
+			decodererr = a.streamer(json.NewDecoder(childout), childin, childout)
+		} else if a.ResultCache != nil {
+			decodererr = a.ResultCache.decode(json.NewDecoder(childout), a.Result)
+		} else {
+			decodererr = json.NewDecoder(childout).Decode(a.Result)
+		}
 	}
 	// Either wait for the child to automatically terminate within a short
 	// grace period after we deserialized its result output, or kill it the
-	// hard way if it can't terminate in time.
-	done := make(chan error, 1)
-	go func() {
-		done <- forkchild.Wait()
-	}()
-	select {
-	case err = <-done:
-	case <-time.After(1 * time.Second):
-		_ = forkchild.Process.Kill()
+	// hard way if it can't terminate in time. In the latter case we're not
+	// interested in the child's exit status, as we already got the result.
+	var killed int32
+	killer := time.AfterFunc(killGracePeriod, func() {
+		atomic.StoreInt32(&killed, 1)
+		_ = forkchild.Kill()
+	})
+	state, err := forkchild.Wait()
+	killer.Stop()
+	timedout := atomic.LoadInt32(&killed) != 0
+	if timedout {
+		err = nil
+	} else if err == nil && !state.Success() {
+		err = &exec.ExitError{ProcessState: state}
 	}
 	// Wait for the stderr pipe to properly wind down, so we got all that there
 	// is to get.
 	<-errdone
+	// Pick up any problem with reading the streamed parameter; as the child
+	// is gone by now, the copy will finish soon unless the reader blocks. In
+	// the latter case we don't wait forever, but close the child's stdin as
+	// well as the reader if it can be closed, and then leave the blocked
+	// copy behind.
+	if streamdone != nil {
+		grace := time.NewTimer(killGracePeriod)
+		select {
+		case encodererr = <-streamdone:
+		case <-grace.C:
+			_ = childin.Close()
+			if closer, ok := a.ParamReader.(io.Closer); ok {
+				_ = closer.Close()
+			}
+			encodererr = errParamReaderBlocked
+		}
+		grace.Stop()
+	}
 	// Any child stderr output takes precedence over decoder errors, as when the
 	// child panics, then that is of more importance than any hiccup the result
 	// decoder encounters due to the child's problems. However, any encoder
 	// error takes it all...
 	if encodererr != nil {
-		return fmt.Errorf(
+		return timedout, fmt.Errorf(
 			"gons/reexec: ReexecAction.Run: cannot send parameter to child, reason: %w",
-			decodererr)
+			encodererr)
 	}
-	childhiccup := childerr.String()
-	if childhiccup != "" {
-		return fmt.Errorf(
-			"gons/reexec: ReexecAction.Run: child failed with stderr message %q",
-			childhiccup)
+	if childerr.Len() != 0 {
+		stderr := childerr.String()
+		return timedout || strings.Contains(stderr, namespaceSwitchFailure),
+			&ChildStderrError{
+				Stderr:    stderr,
+				Truncated: childerr.Truncated(),
+			}
 	}
 	if decodererr != nil {
-		return fmt.Errorf(
+		return timedout, fmt.Errorf(
 			"gons/reexec: ReexecAction.Run: cannot decode child result, reason: %w",
 			decodererr)
 	}
-	return err
+	return timedout, err
 }
 
 // ForkReexec restarts the application using reexec as a new child process and
@@ -353,18 +601,59 @@ func ForkReexecEnv(actionname string, namespaces []Namespace, envvars []string,
 type Action func()
 
 // actions maps re-execution topics (names) to action functions to execute on
-// a scheduled re-execution.
-var actions = map[string]Action{}
+// a scheduled re-execution. As actions are looked up by any number of
+// concurrent re-executions, while registrations are rare (and typically only
+// happen during package initialization), the map is never modified once
+// published. Instead, registrations publish a modified copy, so lookups don't
+// need any locking. Registrations are serialized using actionsMu.
+var (
+	actions   atomic.Value // map[string]registeredAction
+	actionsMu sync.Mutex
+)
+
+// registeredAction is an action function together with the preformatted
+// environment variable for re-executing into it.
+type registeredAction struct {
+	action Action
+	env    string
+}
+
+// lookupAction returns the action registered under the specified name, if
+// any.
+func lookupAction(name string) (Action, bool) {
+	registered, _ := actions.Load().(map[string]registeredAction)
+	ra, ok := registered[name]
+	return ra.action, ok
+}
+
+// actionEnviron returns the environment variable telling a child to run the
+// named action, preformatted for registered actions.
+func actionEnviron(name string) string {
+	registered, _ := actions.Load().(map[string]registeredAction)
+	if ra, ok := registered[name]; ok {
+		return ra.env
+	}
+	return magicEnvVar + "=" + name
+}
 
 // Register registers a Action function with a name so it can be
 // triggered during ForkReexec(name, ...). The registration panics if the same
 // Action name is registered more than once, regardless of whether with the
-// same Action or different ones.
+// same Action or different ones. It is safe to register actions while other
+// go routines are re-executing actions.
 func Register(name string, action Action) {
-	if _, ok := actions[name]; ok {
+	actionsMu.Lock()
+	defer actionsMu.Unlock()
+	registered, _ := actions.Load().(map[string]registeredAction)
+	if _, ok := registered[name]; ok {
 		panic(fmt.Sprintf(
 			"gons/reexec: registerAction: re-execution action %q already registered",
 			name))
 	}
-	actions[name] = action
+	updated := make(map[string]registeredAction, len(registered)+1)
+	for n, ra := range registered {
+		updated[n] = ra
+	}
+	updated[name] = registeredAction{action: action, env: magicEnvVar + "=" + name}
+	actions.Store(updated)
 }
@@ -19,6 +19,9 @@ import (
 	"fmt"
 	"math/rand"
 	"os"
+	"sync"
+	"sync/atomic"
+	"testing"
 	"time"
 
 	. "github.com/onsi/ginkgo/v2"
@@ -56,6 +59,10 @@ func init() {
 	Register("silent", func() {})
 }
 
+// concurrentRegistrationRuns counts the runs of the concurrent registration
+// spec, in order to register fresh action names on each run.
+var concurrentRegistrationRuns atomic.Int32
+
 var _ = Describe("reexec", func() {
 
 	It("runs action and exits", func() {
@@ -94,8 +101,8 @@ var _ = Describe("reexec", func() {
 	})
 
 	It("panics when re-execution wasn't properly enabled", func() {
-		defer func(old bool) { reexecEnabled = old }(reexecEnabled)
-		reexecEnabled = false
+		defer func(old bool) { reexecEnabled.Store(old) }(reexecEnabled.Load())
+		reexecEnabled.Store(false)
 		Expect(func() { _ = ForkReexec("action", []Namespace{}, nil) }).To(Panic())
 	})
 
@@ -104,6 +111,35 @@ var _ = Describe("reexec", func() {
 		Expect(func() { Register("foo", func() {}) }).To(Panic())
 	})
 
+	It("registers and re-executes concurrently", func() {
+		// As actions can never be unregistered, we need fresh action names
+		// whenever this spec gets run again, such as when repeating tests.
+		run := concurrentRegistrationRuns.Add(1)
+		var wg sync.WaitGroup
+		errs := make(chan error, 20)
+		for i := 0; i < 10; i++ {
+			wg.Add(2)
+			go func(i int) {
+				defer wg.Done()
+				Register(fmt.Sprintf("concurrent-%d-%d", run, i), func() {})
+			}(i)
+			go func() {
+				defer wg.Done()
+				var s string
+				errs <- RunReexecAction("action", Result(&s))
+			}()
+		}
+		wg.Wait()
+		close(errs)
+		for err := range errs {
+			Expect(err).NotTo(HaveOccurred())
+		}
+		for i := 0; i < 10; i++ {
+			_, ok := lookupAction(fmt.Sprintf("concurrent-%d-%d", run, i))
+			Expect(ok).To(BeTrue())
+		}
+	})
+
 	It("doesn't accept triggering a non-registered action", func() {
 		Expect(func() { _ = ForkReexec("xxx", []Namespace{}, nil) }).To(Panic())
 	})
@@ -158,3 +194,22 @@ var _ = Describe("reexec", func() {
 	})
 
 })
+
+// BenchmarkRunReexecAction measures the common case of a re-executed action
+// without parameter and with only a small result; run with "-benchmem" to
+// see the parent's allocations per re-execution.
+func BenchmarkRunReexecAction(b *testing.B) {
+	namespaces := Namespaces([]Namespace{
+		{Type: "!net", Path: "/proc/self/ns/net"},
+		{Type: "!ipc", Path: "/proc/self/ns/ipc"},
+	})
+	scrub := ScrubEnvironment("PATH")
+	b.ReportAllocs()
+	b.ResetTimer()
+	for n := 0; n < b.N; n++ {
+		var s string
+		if err := RunReexecAction("action", namespaces, scrub, Result(&s)); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
@@ -0,0 +1,73 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import "strconv"
+
+// RuntimeProfile tunes the Go runtime of a re-executed child. Re-executed
+// children typically live only for milliseconds, yet by default they spin up
+// their Go runtime just like the parent did: with as many Ps as there are
+// CPUs, the default GC pacing and without any memory limit. On large nodes
+// this costs startup time and RSS for every child.
+//
+// The profile is applied via the child's environment, so it is in place
+// before the child's Go runtime spins up. Zero fields are not set and thus
+// inherited from the parent's environment (or the Go runtime defaults).
+type RuntimeProfile struct {
+	GOMAXPROCS int    // max. number of OS threads running Go code at the same time.
+	GOGC       string // GC target percentage, or "off".
+	GOMEMLIMIT string // soft memory limit, such as "256MiB".
+	GODEBUG    string // comma-separated list of runtime debug settings.
+}
+
+// LowOverheadRuntime is a runtime profile suitable for short-lived actions
+// that don't do much work in parallel and that allocate only moderately: it
+// limits the child to two Ps and turns off GC pacing, with a soft memory
+// limit as the backstop for the odd action that allocates more than
+// expected.
+var LowOverheadRuntime = RuntimeProfile{
+	GOMAXPROCS: 2,
+	GOGC:       "off",
+	GOMEMLIMIT: "256MiB",
+}
+
+// Runtime specifies the Go runtime profile of the re-executed child. Any
+// runtime variables also specified using Environment take precedence.
+func Runtime(profile RuntimeProfile) ReexecActionOption {
+	rtenv := profile.environ()
+	return func(a *ReexecAction) {
+		a.Runtime = profile
+		a.rtenv, a.rtenvOf = rtenv, profile
+	}
+}
+
+// environ returns the environment variables implementing this runtime
+// profile.
+func (p RuntimeProfile) environ() []string {
+	var env []string
+	if p.GOMAXPROCS > 0 {
+		env = append(env, "GOMAXPROCS="+strconv.Itoa(p.GOMAXPROCS))
+	}
+	if p.GOGC != "" {
+		env = append(env, "GOGC="+p.GOGC)
+	}
+	if p.GOMEMLIMIT != "" {
+		env = append(env, "GOMEMLIMIT="+p.GOMEMLIMIT)
+	}
+	if p.GODEBUG != "" {
+		env = append(env, "GODEBUG="+p.GODEBUG)
+	}
+	return env
+}
@@ -0,0 +1,109 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"encoding/json"
+	"os"
+	"runtime"
+	"runtime/debug"
+	"syscall"
+	"testing"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+// childRuntime is what the "runtime" action reports back about its Go
+// runtime.
+type childRuntime struct {
+	GOMAXPROCS int    `json:"gomaxprocs"`
+	GOGC       string `json:"gogc"`
+	MemLimit   int64  `json:"memlimit"`
+	MaxRSS     int64  `json:"maxrss"` // in kB
+}
+
+func init() {
+	Register("runtime", func() {
+		var rusage syscall.Rusage
+		_ = syscall.Getrusage(syscall.RUSAGE_SELF, &rusage)
+		_ = json.NewEncoder(os.Stdout).Encode(childRuntime{
+			GOMAXPROCS: runtime.GOMAXPROCS(0),
+			GOGC:       os.Getenv("GOGC"),
+			MemLimit:   debug.SetMemoryLimit(-1),
+			MaxRSS:     rusage.Maxrss,
+		})
+	})
+}
+
+var _ = Describe("child runtime profile", func() {
+
+	It("generates only the necessary env vars", func() {
+		Expect(RuntimeProfile{}.environ()).To(BeEmpty())
+		Expect(LowOverheadRuntime.environ()).To(ConsistOf(
+			"GOMAXPROCS=2", "GOGC=off", "GOMEMLIMIT=256MiB"))
+		Expect(RuntimeProfile{GODEBUG: "madvdontneed=1"}.environ()).To(ConsistOf(
+			"GODEBUG=madvdontneed=1"))
+	})
+
+	It("applies the runtime profile to the child", func() {
+		var rt childRuntime
+		Expect(RunReexecAction("runtime",
+			Runtime(RuntimeProfile{GOMAXPROCS: 1, GOGC: "123", GOMEMLIMIT: "42MiB"}),
+			Result(&rt))).To(Succeed())
+		Expect(rt.GOMAXPROCS).To(Equal(1))
+		Expect(rt.GOGC).To(Equal("123"))
+		Expect(rt.MemLimit).To(Equal(int64(42 << 20)))
+	})
+
+	It("lets explicit environment variables take precedence", func() {
+		var rt childRuntime
+		Expect(RunReexecAction("runtime",
+			Runtime(LowOverheadRuntime),
+			Environment([]string{"GOGC=50"}),
+			Result(&rt))).To(Succeed())
+		Expect(rt.GOMAXPROCS).To(Equal(2))
+		Expect(rt.GOGC).To(Equal("50"))
+	})
+
+})
+
+// BenchmarkRuntimeProfile compares the wall clock time and peak RSS of
+// re-executed children with inherited runtime settings to children with the
+// LowOverheadRuntime profile. The difference grows with the number of CPUs
+// of the machine the benchmark is run on.
+func BenchmarkRuntimeProfile(b *testing.B) {
+	for _, bm := range []struct {
+		name    string
+		profile RuntimeProfile
+	}{
+		{name: "inherited"},
+		{name: "lowoverhead", profile: LowOverheadRuntime},
+	} {
+		b.Run(bm.name, func(b *testing.B) {
+			var maxrss int64
+			for n := 0; n < b.N; n++ {
+				var rt childRuntime
+				if err := RunReexecAction("runtime",
+					Runtime(bm.profile),
+					Result(&rt)); err != nil {
+					b.Fatal(err)
+				}
+				maxrss += rt.MaxRSS
+			}
+			b.ReportMetric(float64(maxrss)/float64(b.N), "child-maxrss-kB/op")
+		})
+	}
+}
@@ -0,0 +1,140 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"strconv"
+	"strings"
+)
+
+// maxCPUs is the maximum number of CPUs supported in CPU affinity masks; it
+// corresponds with glibc's CPU_SETSIZE.
+const maxCPUs = 1024
+
+// SchedPolicy is a Linux scheduling policy for re-executed children.
+type SchedPolicy string
+
+// Scheduling policies for re-executed children; the real-time policies are
+// deliberately not supported.
+const (
+	SchedOther SchedPolicy = "other" // standard round-robin time-sharing.
+	SchedBatch SchedPolicy = "batch" // CPU-intensive non-interactive work.
+	SchedIdle  SchedPolicy = "idle"  // very low priority background work.
+)
+
+// IOPrioClass is a Linux I/O scheduling class for re-executed children.
+type IOPrioClass string
+
+// I/O scheduling classes for re-executed children.
+const (
+	IOPrioRealtime   IOPrioClass = "rt"   // needs CAP_SYS_ADMIN.
+	IOPrioBestEffort IOPrioClass = "be"   // default class.
+	IOPrioIdle       IOPrioClass = "idle" // only when nobody else needs the disk.
+)
+
+// Scheduling describes the CPU affinity, scheduling policy, nice value and
+// I/O priority of a re-executed child. The gons package applies them in the
+// child before the Go runtime spins up, so all runtime threads inherit them.
+// Zero values inherit from the parent.
+type Scheduling struct {
+	CPUs    []int       // CPU affinity.
+	Policy  SchedPolicy // scheduling policy.
+	Nice    *int        // nice value in [-20, 19].
+	IOClass IOPrioClass // I/O scheduling class.
+	IOLevel int         // I/O priority level in [0, 7], unless IOPrioIdle.
+}
+
+// CPUAffinity restricts a re-executed child to the specified CPUs.
+func CPUAffinity(cpus ...int) ReexecActionOption {
+	for _, cpu := range cpus {
+		if cpu < 0 || cpu >= maxCPUs {
+			panic("gons/reexec: CPUAffinity: invalid CPU " + strconv.Itoa(cpu))
+		}
+	}
+	return func(a *ReexecAction) {
+		a.Scheduling.CPUs = cpus
+	}
+}
+
+// SchedulingPolicy sets the scheduling policy of a re-executed child.
+func SchedulingPolicy(policy SchedPolicy) ReexecActionOption {
+	switch policy {
+	case SchedOther, SchedBatch, SchedIdle:
+	default:
+		panic("gons/reexec: SchedulingPolicy: invalid policy \"" + string(policy) + "\"")
+	}
+	return func(a *ReexecAction) {
+		a.Scheduling.Policy = policy
+	}
+}
+
+// Nice sets the nice value of a re-executed child. Please note that lowering
+// the nice value below the parent's needs CAP_SYS_NICE.
+func Nice(nice int) ReexecActionOption {
+	if nice < -20 || nice > 19 {
+		panic("gons/reexec: Nice: invalid nice value " + strconv.Itoa(nice))
+	}
+	return func(a *ReexecAction) {
+		a.Scheduling.Nice = &nice
+	}
+}
+
+// IOPriority sets the I/O scheduling class and priority level of a
+// re-executed child. The level is ignored for IOPrioIdle.
+func IOPriority(class IOPrioClass, level int) ReexecActionOption {
+	switch class {
+	case IOPrioRealtime, IOPrioBestEffort, IOPrioIdle:
+	default:
+		panic("gons/reexec: IOPriority: invalid class \"" + string(class) + "\"")
+	}
+	if level < 0 || level > 7 {
+		panic("gons/reexec: IOPriority: invalid level " + strconv.Itoa(level))
+	}
+	return func(a *ReexecAction) {
+		a.Scheduling.IOClass = class
+		a.Scheduling.IOLevel = level
+	}
+}
+
+// environ returns the "gons_*" environment variables telling the gons package
+// in a re-executed child how to schedule itself, or nil if the scheduling is
+// to be inherited.
+func (s *Scheduling) environ() (env []string) {
+	if len(s.CPUs) != 0 {
+		var cpus strings.Builder
+		cpus.WriteString("gons_cpus=")
+		for idx, cpu := range s.CPUs {
+			if idx > 0 {
+				cpus.WriteByte(',')
+			}
+			cpus.WriteString(strconv.Itoa(cpu))
+		}
+		env = append(env, cpus.String())
+	}
+	if s.Policy != "" {
+		env = append(env, "gons_sched="+string(s.Policy))
+	}
+	if s.Nice != nil {
+		env = append(env, "gons_nice="+strconv.Itoa(*s.Nice))
+	}
+	switch s.IOClass {
+	case "":
+	case IOPrioIdle:
+		env = append(env, "gons_ioprio=idle")
+	default:
+		env = append(env, "gons_ioprio="+string(s.IOClass)+":"+strconv.Itoa(s.IOLevel))
+	}
+	return
+}
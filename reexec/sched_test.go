@@ -0,0 +1,138 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"encoding/json"
+	"os"
+	"path/filepath"
+	"strconv"
+	"strings"
+	"syscall"
+	"time"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+// schedInfo describes the scheduling of a re-executed child, with the nice
+// values and scheduling policies of all its threads.
+type schedInfo struct {
+	CPUs     string
+	Nices    []int
+	Policies []int
+	IOPrio   int
+}
+
+func init() {
+	Register("sched", func() {
+		info := schedInfo{}
+		status, _ := os.ReadFile("/proc/self/status")
+		for _, line := range strings.Split(string(status), "\n") {
+			if strings.HasPrefix(line, "Cpus_allowed_list:") {
+				info.CPUs = strings.TrimSpace(line[len("Cpus_allowed_list:"):])
+			}
+		}
+		tasks, _ := filepath.Glob("/proc/self/task/*/stat")
+		for _, task := range tasks {
+			stat, _ := os.ReadFile(task)
+			// Fields following the command name in parentheses start with the
+			// 3rd field "state"; we need the 19th "nice" and 41st "policy".
+			fields := strings.Fields(string(stat[strings.LastIndexByte(string(stat), ')')+1:]))
+			nice, _ := strconv.Atoi(fields[19-3])
+			policy, _ := strconv.Atoi(fields[41-3])
+			info.Nices = append(info.Nices, nice)
+			info.Policies = append(info.Policies, policy)
+		}
+		ioprio, _, _ := syscall.Syscall(syscall.SYS_IOPRIO_GET, 1, 0, 0)
+		info.IOPrio = int(ioprio)
+		_ = json.NewEncoder(os.Stdout).Encode(info)
+	})
+}
+
+var _ = Describe("child scheduling", func() {
+
+	It("rejects invalid settings", func() {
+		Expect(func() { CPUAffinity(-1) }).To(Panic())
+		Expect(func() { CPUAffinity(maxCPUs) }).To(Panic())
+		Expect(func() { SchedulingPolicy("fifo") }).To(Panic())
+		Expect(func() { Nice(20) }).To(Panic())
+		Expect(func() { IOPriority("foo", 0) }).To(Panic())
+		Expect(func() { IOPriority(IOPrioBestEffort, 8) }).To(Panic())
+	})
+
+	It("formats the environment", func() {
+		Expect(NewReexecAction("sched").Scheduling.environ()).To(BeEmpty())
+		Expect(NewReexecAction("sched",
+			CPUAffinity(0, 2, 3),
+			SchedulingPolicy(SchedIdle),
+			Nice(-5),
+			IOPriority(IOPrioIdle, 7)).Scheduling.environ()).To(Equal([]string{
+			"gons_cpus=0,2,3", "gons_sched=idle", "gons_nice=-5", "gons_ioprio=idle",
+		}))
+		Expect(NewReexecAction("sched",
+			IOPriority(IOPrioBestEffort, 6)).Scheduling.environ()).To(Equal([]string{
+			"gons_ioprio=be:6",
+		}))
+	})
+
+	It("schedules all threads of the child", func() {
+		var info schedInfo
+		Expect(RunReexecAction("sched",
+			CPUAffinity(0),
+			SchedulingPolicy(SchedBatch),
+			Nice(5),
+			IOPriority(IOPrioBestEffort, 7),
+			Result(&info))).To(Succeed())
+		Expect(info.CPUs).To(Equal("0"))
+		Expect(len(info.Nices)).To(BeNumerically(">", 1))
+		for idx := range info.Nices {
+			Expect(info.Nices[idx]).To(Equal(5))
+			Expect(info.Policies[idx]).To(Equal(3)) // SCHED_BATCH
+		}
+		Expect(info.IOPrio).To(Equal(2<<13 | 7))
+
+		Expect(RunReexecAction("sched",
+			SchedulingPolicy(SchedIdle),
+			IOPriority(IOPrioIdle, 0),
+			Result(&info))).To(Succeed())
+		for idx := range info.Policies {
+			Expect(info.Policies[idx]).To(Equal(5)) // SCHED_IDLE
+		}
+		Expect(info.IOPrio).To(Equal(3 << 13))
+	})
+
+	It("reports invalid scheduling environment variables", func() {
+		for _, envvar := range []string{
+			"gons_cpus=0-foo", "gons_sched=fifo", "gons_nice=42", "gons_ioprio=be:8",
+		} {
+			Expect(RunReexecAction("sched", Environment([]string{envvar}))).To(
+				MatchError(MatchRegexp(`package gons: invalid ` + envvar[:strings.IndexByte(envvar, '=')])))
+		}
+	})
+
+	It("doesn't count scheduling failures against the target namespaces", func() {
+		ft := NewFailureTracker(1, time.Minute)
+		for i := 0; i < 2; i++ {
+			err := RunReexecAction("sched",
+				Namespaces([]Namespace{{Type: "mnt", Path: "/proc/self/ns/mnt"}}),
+				Environment([]string{"gons_nice=42"}),
+				TrackFailures(ft))
+			Expect(err).To(MatchError(MatchRegexp(
+				`cannot apply scheduling settings: package gons: invalid gons_nice`)))
+		}
+	})
+
+})
@@ -0,0 +1,194 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"fmt"
+	"io"
+	"strconv"
+	"sync"
+)
+
+// DefaultStderrLimit is the maximum number of bytes of a child's stderr
+// output kept by default. That's plenty for the usual error message, as well
+// as for the interesting parts of a panic's stack dump.
+const DefaultStderrLimit = 64 * 1024
+
+// StderrLimit limits the amount of stderr output kept from the re-executed
+// child to the specified number of bytes: the head and the tail of the output
+// are kept, with the middle part getting dropped. Any output on stderr still
+// makes the re-execution fail. A zero limit uses DefaultStderrLimit, while a
+// negative limit keeps the child's stderr output completely, regardless of
+// its size.
+func StderrLimit(limit int) ReexecActionOption {
+	return func(a *ReexecAction) {
+		a.StderrLimit = limit
+	}
+}
+
+// ChildStderrError reports that a re-executed child wrote to stderr, which
+// always indicates failure. The child's stderr output might have been
+// truncated in its middle part.
+type ChildStderrError struct {
+	Stderr    string // (truncated) stderr output of the child.
+	Truncated int64  // number of stderr bytes dropped.
+}
+
+// Error returns a description of the child's failure, including its stderr
+// output.
+func (e *ChildStderrError) Error() string {
+	return fmt.Sprintf(
+		"gons/reexec: ReexecAction.Run: child failed with stderr message %q",
+		e.Stderr)
+}
+
+// headTailBuffer keeps only the first and the last bytes written to it, up to
+// a limit. The first half of the limit goes to the head, the remaining
+// capacity is used as a ring buffer for the tail. All buffers are allocated
+// lazily, so the usual small or non-existing stderr output costs next to
+// nothing.
+type headTailBuffer struct {
+	limit   int    // maximum number of bytes kept, or negative for unlimited.
+	head    []byte // the first bytes written.
+	tail    []byte // ring buffer of the most recent bytes after the head.
+	tailpos int    // position of next write into the tail ring buffer.
+	total   int64  // total number of bytes written.
+	scratch []byte // for reading from an io.Reader.
+}
+
+// stderrPool recycles the buffers collecting the stderr output of children.
+var stderrPool = sync.Pool{
+	New: func() interface{} { return &headTailBuffer{} },
+}
+
+// newHeadTailBuffer returns a (recycled) buffer for the specified limit.
+func newHeadTailBuffer(limit int) *headTailBuffer {
+	b := stderrPool.Get().(*headTailBuffer)
+	if limit == 0 {
+		limit = DefaultStderrLimit
+	}
+	b.limit = limit
+	return b
+}
+
+// release resets the buffer and returns it into its pool, unless it has grown
+// too large.
+func (b *headTailBuffer) release() {
+	if cap(b.head)+cap(b.tail) > 2*maxPooledBufferSize {
+		return
+	}
+	b.head = b.head[:0]
+	b.tail = b.tail[:0]
+	b.tailpos = 0
+	b.total = 0
+	stderrPool.Put(b)
+}
+
+// headcap returns the maximum number of bytes to keep in the head.
+func (b *headTailBuffer) headcap() int {
+	if b.limit < 0 {
+		return int(^uint(0) >> 1)
+	}
+	return b.limit / 2
+}
+
+// Write keeps the first written bytes up to the head limit, and afterwards
+// only the most recent bytes up to the tail limit.
+func (b *headTailBuffer) Write(p []byte) (int, error) {
+	n := len(p)
+	b.total += int64(n)
+	if room := b.headcap() - len(b.head); room > 0 {
+		if room > len(p) {
+			room = len(p)
+		}
+		b.head = append(b.head, p[:room]...)
+		p = p[room:]
+	}
+	tailcap := b.limit - b.headcap()
+	if len(p) == 0 || tailcap <= 0 {
+		return n, nil
+	}
+	// Only the last tailcap bytes can survive anyway.
+	if len(p) > tailcap {
+		p = p[len(p)-tailcap:]
+	}
+	// Fill the ring buffer until it has reached its capacity, then start
+	// overwriting the oldest bytes.
+	if room := tailcap - len(b.tail); room > 0 {
+		if cap(b.tail) < tailcap {
+			b.tail = append(make([]byte, 0, tailcap), b.tail...)
+		}
+		if room > len(p) {
+			room = len(p)
+		}
+		b.tail = append(b.tail, p[:room]...)
+		p = p[room:]
+	}
+	for len(p) > 0 {
+		c := copy(b.tail[b.tailpos:], p)
+		p = p[c:]
+		b.tailpos = (b.tailpos + c) % len(b.tail)
+	}
+	return n, nil
+}
+
+// ReadFrom reads from r until EOF or error, keeping the head and tail of the
+// data read.
+func (b *headTailBuffer) ReadFrom(r io.Reader) (n int64, err error) {
+	if b.scratch == nil {
+		b.scratch = make([]byte, 4096)
+	}
+	for {
+		c, err := r.Read(b.scratch)
+		if c > 0 {
+			n += int64(c)
+			_, _ = b.Write(b.scratch[:c])
+		}
+		if err != nil {
+			if err == io.EOF {
+				err = nil
+			}
+			return n, err
+		}
+	}
+}
+
+// Len returns the total number of bytes written to the buffer, including
+// the dropped ones.
+func (b *headTailBuffer) Len() int64 { return b.total }
+
+// Truncated returns the number of bytes dropped.
+func (b *headTailBuffer) Truncated() int64 {
+	return b.total - int64(len(b.head)+len(b.tail))
+}
+
+// String returns the kept head and tail, with a marker in between if bytes
+// were dropped.
+func (b *headTailBuffer) String() string {
+	truncated := b.Truncated()
+	if truncated == 0 {
+		// When nothing has been dropped, the tail ring buffer hasn't wrapped
+		// around yet.
+		return string(b.head) + string(b.tail)
+	}
+	s := make([]byte, 0, len(b.head)+len(b.tail)+48)
+	s = append(s, b.head...)
+	s = append(s, "\n[... "...)
+	s = strconv.AppendInt(s, truncated, 10)
+	s = append(s, " bytes truncated ...]\n"...)
+	s = append(s, b.tail[b.tailpos:]...)
+	s = append(s, b.tail[:b.tailpos]...)
+	return string(s)
+}
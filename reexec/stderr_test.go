@@ -0,0 +1,81 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"errors"
+	"fmt"
+	"os"
+	"strings"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+func init() {
+	Register("chatterbox", func() {
+		fmt.Fprint(os.Stderr, "HEAD")
+		fmt.Fprint(os.Stderr, strings.Repeat("-", 1024*1024))
+		fmt.Fprint(os.Stderr, "TAIL")
+	})
+}
+
+var _ = Describe("stderr capture", func() {
+
+	It("keeps everything below the limit", func() {
+		b := newHeadTailBuffer(8)
+		defer b.release()
+		_, _ = b.Write([]byte("abc"))
+		_, _ = b.Write([]byte("defgh"))
+		Expect(b.String()).To(Equal("abcdefgh"))
+		Expect(b.Len()).To(Equal(int64(8)))
+		Expect(b.Truncated()).To(BeZero())
+	})
+
+	It("keeps head and tail", func() {
+		b := newHeadTailBuffer(8)
+		defer b.release()
+		for _, s := range []string{"ab", "cdef", "ghi", "j", "klmnop", "q"} {
+			_, _ = b.Write([]byte(s))
+		}
+		Expect(b.Truncated()).To(Equal(int64(17 - 8)))
+		Expect(b.String()).To(Equal("abcd\n[... 9 bytes truncated ...]\nnopq"))
+
+		b2 := newHeadTailBuffer(8)
+		defer b2.release()
+		_, _ = b2.Write([]byte("abcdefghijklmnopq"))
+		Expect(b2.String()).To(Equal(b.String()))
+	})
+
+	It("optionally doesn't limit", func() {
+		b := newHeadTailBuffer(-1)
+		defer b.release()
+		long := strings.Repeat("x", 3*DefaultStderrLimit)
+		_, _ = b.Write([]byte(long))
+		Expect(b.String()).To(Equal(long))
+		Expect(b.Truncated()).To(BeZero())
+	})
+
+	It("reports truncated child stderr output", func() {
+		err := RunReexecAction("chatterbox", StderrLimit(1024))
+		var stderrerr *ChildStderrError
+		Expect(errors.As(err, &stderrerr)).To(BeTrue())
+		Expect(stderrerr.Truncated).To(Equal(int64(1024*1024 + 8 - 1024)))
+		Expect(stderrerr.Stderr).To(HavePrefix("HEAD"))
+		Expect(stderrerr.Stderr).To(MatchRegexp(`\[\.\.\. 1047560 bytes truncated \.\.\.\]\n-+TAIL$`))
+		Expect(err).To(MatchError(MatchRegexp(`ReexecAction.Run: child failed with stderr message "HEAD-+\\n\[\.\.\. 1047560`)))
+	})
+
+})
@@ -0,0 +1,171 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"encoding/json"
+	"fmt"
+	"io"
+	"os"
+	"sync"
+	"time"
+)
+
+// Subscription is a long-lived re-executed child that stays in its
+// namespaces, running a watch action that streams events back to the parent
+// until either the action finishes or the subscription gets closed. This
+// replaces polling by repeatedly re-executing with pushing changes.
+//
+// Please note that a subscription's child counts as a running child for the
+// whole lifetime of the subscription when it comes to AdmissionLimits.
+type Subscription struct {
+	events    chan json.RawMessage
+	cancel    chan struct{}
+	cancelled sync.Once
+	done      chan struct{}
+	err       error
+}
+
+// Subscribe re-executes the named watch action in a long-lived child with the
+// specified options, returning a Subscription to receive the events published
+// by the action. Any Result option is ignored. The action should call
+// Publish() for each event and return when Unsubscribed() gets closed.
+//
+// As the child gets re-executed in the background, any problems re-executing
+// it, such as an unregistered action, end the subscription with Err()
+// reporting them, instead of panicking.
+func Subscribe(actionname string, options ...ReexecActionOption) *Subscription {
+	a := NewReexecAction(actionname, options...)
+	if a.ParamReader != nil {
+		// The end of the parameter stream would unsubscribe immediately.
+		panic("gons/reexec: Subscribe: cannot stream parameter to watch action")
+	}
+	s := &Subscription{
+		events: make(chan json.RawMessage),
+		cancel: make(chan struct{}),
+		done:   make(chan struct{}),
+	}
+	a.streamer = s.stream
+	go func() {
+		defer close(s.done)
+		defer close(s.events)
+		defer func() {
+			if r := recover(); r != nil {
+				s.err = fmt.Errorf("gons/reexec: Subscribe: cannot subscribe, reason: %v", r)
+			}
+		}()
+		s.err = a.Run()
+	}()
+	return s
+}
+
+// Events returns the channel of events published by the watch action. The
+// channel gets closed when the action has finished or the subscription has
+// been closed, after which Err() returns any error.
+func (s *Subscription) Events() <-chan json.RawMessage { return s.events }
+
+// Err returns the error, if any, that ended the subscription. It must only be
+// called after the Events() channel has been closed.
+func (s *Subscription) Err() error {
+	<-s.done
+	return s.err
+}
+
+// Close cancels the subscription, waits for the child to terminate, and
+// returns the error, if any, that ended the subscription. Events not yet
+// received get dropped. Close can be called multiple times.
+func (s *Subscription) Close() error {
+	s.cancelled.Do(func() { close(s.cancel) })
+	<-s.done
+	return s.err
+}
+
+// stream receives the events from the child and passes them on until the
+// child ends its output. On cancellation, it signals the child by closing the
+// child's stdin. If the child then doesn't terminate within the grace period,
+// its output gets cut off, so that Run() can kill it the hard way.
+func (s *Subscription) stream(dec *json.Decoder, childin, childout *os.File) error {
+	stop := make(chan struct{})
+	defer close(stop)
+	go func() {
+		select {
+		case <-s.cancel:
+			_ = childin.Close()
+			cutoff := time.NewTimer(killGracePeriod)
+			defer cutoff.Stop()
+			select {
+			case <-cutoff.C:
+				_ = childout.Close()
+			case <-stop:
+			}
+		case <-stop:
+		}
+	}()
+	for {
+		var event json.RawMessage
+		if err := dec.Decode(&event); err != nil {
+			select {
+			case <-s.cancel:
+				return nil
+			default:
+			}
+			if err == io.EOF {
+				return nil
+			}
+			return err
+		}
+		select {
+		case s.events <- event:
+		case <-s.cancel:
+		}
+	}
+}
+
+// publishMu serializes publishing events from a watch action.
+var publishMu sync.Mutex
+
+// Publish sends an event from a watch action running in a re-executed child
+// to the parent's Subscription. It can be called from multiple go routines.
+func Publish(event interface{}) error {
+	pe := paramPool.Get().(*paramEncoder)
+	defer putBuffer(&paramPool, &pe.buf, pe)
+	if err := pe.enc.Encode(event); err != nil {
+		return err
+	}
+	publishMu.Lock()
+	defer publishMu.Unlock()
+	_, err := os.Stdout.Write(pe.buf.Bytes())
+	return err
+}
+
+var (
+	unsubscribed     chan struct{}
+	unsubscribedOnce sync.Once
+)
+
+// Unsubscribed returns a channel that gets closed when the parent closes its
+// Subscription, or when the parent is gone. A watch action with a parameter
+// must have decoded its parameter from os.Stdin before calling Unsubscribed
+// for the first time, as this drains os.Stdin.
+func Unsubscribed() <-chan struct{} {
+	unsubscribedOnce.Do(func() {
+		unsubscribed = make(chan struct{})
+		go func() {
+			_, _ = io.Copy(io.Discard, os.Stdin)
+			close(unsubscribed)
+		}()
+	})
+	return unsubscribed
+}
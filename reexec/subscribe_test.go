@@ -0,0 +1,105 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package reexec
+
+import (
+	"encoding/json"
+	"errors"
+	"fmt"
+	"os"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+func init() {
+	Register("watcher", func() {
+		var prefix string
+		if err := json.NewDecoder(os.Stdin).Decode(&prefix); err != nil {
+			fmt.Fprint(os.Stderr, err.Error())
+			return
+		}
+		for i := 1; i <= 3; i++ {
+			_ = Publish(fmt.Sprintf("%s%d", prefix, i))
+		}
+		<-Unsubscribed()
+	})
+	Register("stubborn", func() {
+		_ = Publish("not listening")
+		select {}
+	})
+	Register("oneshot", func() {
+		_ = Publish(42)
+	})
+	Register("grumpy", func() {
+		_ = Publish(42)
+		fmt.Fprint(os.Stderr, "go away")
+	})
+}
+
+var _ = Describe("subscriptions", func() {
+
+	It("streams events until closed", func() {
+		s := Subscribe("watcher", Param("event"))
+		var events []string
+		for len(events) < 3 {
+			var event string
+			Expect(json.Unmarshal(<-s.Events(), &event)).To(Succeed())
+			events = append(events, event)
+		}
+		Expect(events).To(Equal([]string{"event1", "event2", "event3"}))
+		Expect(s.Close()).To(Succeed())
+		Expect(s.Close()).To(Succeed())
+		Expect(s.Err()).To(Succeed())
+		Eventually(s.Events()).Should(BeClosed())
+	})
+
+	It("kills stubborn children", func() {
+		s := Subscribe("stubborn")
+		Eventually(s.Events()).Should(Receive())
+		Expect(s.Close()).To(Succeed())
+	})
+
+	It("ends when the child finishes", func() {
+		s := Subscribe("oneshot")
+		var events []json.RawMessage
+		for event := range s.Events() {
+			events = append(events, event)
+		}
+		Expect(events).To(HaveLen(1))
+		Expect(string(events[0])).To(Equal("42"))
+		Expect(s.Err()).To(Succeed())
+	})
+
+	It("reports child failures", func() {
+		s := Subscribe("grumpy")
+		for range s.Events() {
+		}
+		var stderrerr *ChildStderrError
+		Expect(errors.As(s.Err(), &stderrerr)).To(BeTrue())
+		Expect(stderrerr.Stderr).To(Equal("go away"))
+	})
+
+	It("reports unregistered actions instead of panicking", func() {
+		var s *Subscription
+		Expect(func() { s = Subscribe("nonexisting") }).NotTo(Panic())
+		for range s.Events() {
+		}
+		Expect(s.Err()).To(MatchError(MatchRegexp(
+			`Subscribe: cannot subscribe, reason: .* unregistered action "nonexisting"`)))
+		Expect(s.Close()).To(Equal(s.Err()))
+	})
+
+})
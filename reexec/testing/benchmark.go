@@ -0,0 +1,138 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package testing
+
+import (
+	"encoding/json"
+	"flag"
+	"fmt"
+	"os"
+	"sync"
+	gotesting "testing"
+
+	"github.com/thediveo/gons/reexec/internal/testsupport"
+)
+
+// Namespace describes a Linux kernel namespace into which a re-executed
+// benchmark should switch; it is the same type as gons/reexec.Namespace.
+type Namespace = testsupport.Namespace
+
+// benchmarks are the benchmarks registered for running inside re-executed
+// children, indexed by name.
+var (
+	benchmarks   = map[string]func(b *gotesting.B){}
+	benchmarksMu sync.Mutex
+)
+
+func init() {
+	testsupport.ServeBenchmark = serveBenchmark
+}
+
+// RegisterBenchmark registers a benchmark under the specified name, so that
+// it can be run inside re-executed children using RunBenchmark. Similar to
+// registering actions with gons/reexec.Register, benchmarks must be
+// registered in init functions, so that they are also known to the
+// re-executed children.
+func RegisterBenchmark(name string, bench func(b *gotesting.B)) {
+	benchmarksMu.Lock()
+	defer benchmarksMu.Unlock()
+	if _, ok := benchmarks[name]; ok {
+		panic(fmt.Sprintf(
+			"gons/reexec/testing: RegisterBenchmark: benchmark %q already registered",
+			name))
+	}
+	benchmarks[name] = bench
+}
+
+// benchmarkParam tells a re-executed child which benchmark to run for how
+// long.
+type benchmarkParam struct {
+	Name      string
+	BenchTime string `json:",omitempty"` // parent's "-test.benchtime", if any.
+}
+
+// RunBenchmark runs the registered benchmark of the specified name inside a
+// re-executed child that first switches into the specified namespaces. The
+// child runs the benchmark as usual, that is, with increasing b.N until
+// reaching the benchmark time, and the child's ns/op, B/op and allocs/op, as
+// well as any additional metrics reported by the benchmark, then get reported
+// as the results of the parent's benchmark b. RunBenchmark should thus be the
+// only thing a parent's benchmark function does.
+//
+//	func init() {
+//	    rxtst.RegisterBenchmark("mounts", func(b *testing.B) {
+//	        for n := 0; n < b.N; n++ {
+//	            parseMounts()
+//	        }
+//	    })
+//	}
+//
+//	func BenchmarkMountsInContainer(b *testing.B) {
+//	    rxtst.RunBenchmark(b, "mounts", []reexec.Namespace{{Type: "mnt", Path: "/proc/42/ns/mnt"}})
+//	}
+func RunBenchmark(b *gotesting.B, name string, namespaces []Namespace) {
+	b.Helper()
+	if testsupport.RunBenchmarkAction == nil {
+		b.Fatal("gons/reexec/testing: RunBenchmark: gons/reexec not in use")
+	}
+	param := benchmarkParam{Name: name}
+	if f := flag.Lookup("test.benchtime"); f != nil {
+		param.BenchTime = f.Value.String()
+	}
+	var res gotesting.BenchmarkResult
+	if err := testsupport.RunBenchmarkAction(namespaces, &param, &res); err != nil {
+		b.Fatalf("gons/reexec/testing: RunBenchmark: benchmark %q: %s", name, err.Error())
+	}
+	if res.N == 0 {
+		b.Fatalf("gons/reexec/testing: RunBenchmark: benchmark %q failed", name)
+	}
+	// Our own timings and allocations are meaningless, so we override them
+	// with the child's.
+	b.ReportAllocs()
+	n := float64(res.N)
+	b.ReportMetric(float64(res.T.Nanoseconds())/n, "ns/op")
+	b.ReportMetric(float64(res.MemBytes)/n, "B/op")
+	b.ReportMetric(float64(res.MemAllocs)/n, "allocs/op")
+	for unit, value := range res.Extra {
+		b.ReportMetric(value, unit)
+	}
+}
+
+// serveBenchmark runs inside a re-executed child, running the benchmark
+// requested by the parent and then sending back the benchmark result.
+func serveBenchmark() {
+	var param benchmarkParam
+	if err := json.NewDecoder(os.Stdin).Decode(&param); err != nil {
+		fmt.Fprintf(os.Stderr, "cannot decode benchmark parameter: %s", err.Error())
+		return
+	}
+	benchmarksMu.Lock()
+	bench, ok := benchmarks[param.Name]
+	benchmarksMu.Unlock()
+	if !ok {
+		fmt.Fprintf(os.Stderr, "unregistered benchmark %q", param.Name)
+		return
+	}
+	// As we're running before the testing package has parsed its flags, we
+	// need to pass on the benchmark time ourselves.
+	if param.BenchTime != "" {
+		if err := flag.Set("test.benchtime", param.BenchTime); err != nil {
+			fmt.Fprintf(os.Stderr, "invalid benchmark time: %s", err.Error())
+			return
+		}
+	}
+	res := gotesting.Benchmark(bench)
+	_ = json.NewEncoder(os.Stdout).Encode(&res)
+}
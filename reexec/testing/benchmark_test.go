@@ -0,0 +1,74 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package testing
+
+import (
+	"os"
+	gotesting "testing"
+
+	"github.com/thediveo/gons/reexec/internal/testsupport"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+var sink []byte
+
+func init() {
+	RegisterBenchmark("allocator", func(b *gotesting.B) {
+		for n := 0; n < b.N; n++ {
+			sink = make([]byte, 1024)
+		}
+		b.ReportMetric(42, "answers/op")
+	})
+}
+
+var _ = Describe("benchmarks in re-executed children", func() {
+
+	It("rejects registering the same benchmark twice", func() {
+		Expect(func() { RegisterBenchmark("allocator", nil) }).To(Panic())
+	})
+
+	It("runs a benchmark in a child and reports its results", func() {
+		if os.Getuid() != 0 {
+			Skip("needs root")
+		}
+		res := gotesting.Benchmark(func(b *gotesting.B) {
+			RunBenchmark(b, "allocator", []Namespace{
+				{Type: "net", Path: "/proc/self/ns/net"},
+			})
+		})
+		Expect(res.N).To(Equal(1))
+		Expect(res.Extra).To(HaveKey("ns/op"))
+		Expect(res.Extra["ns/op"]).To(BeNumerically(">", 0))
+		Expect(res.Extra["B/op"]).To(BeNumerically(">=", 1024))
+		Expect(res.Extra["allocs/op"]).To(BeNumerically("~", 1, 0.1))
+		Expect(res.Extra["answers/op"]).To(BeNumerically("==", 42))
+	})
+
+	It("reports unregistered benchmarks", func() {
+		err := testsupport.RunBenchmarkAction(nil,
+			&benchmarkParam{Name: "nonexisting"}, &gotesting.BenchmarkResult{})
+		Expect(err).To(HaveOccurred())
+		Expect(err.Error()).To(ContainSubstring("unregistered benchmark"))
+	})
+
+})
+
+// BenchmarkAllocatorInChild runs the "allocator" benchmark inside a
+// re-executed child.
+func BenchmarkAllocatorInChild(b *gotesting.B) {
+	RunBenchmark(b, "allocator", nil)
+}
@@ -16,9 +16,13 @@ package testing
 
 import (
 	"fmt"
+	"io"
 	"os"
 	"sort"
 	"strings"
+	"sync"
+
+	"github.com/thediveo/gons/reexec/internal/testsupport"
 )
 
 // Testing (coverage) related CLI arguments picked up from os.Args, which are
@@ -26,12 +30,102 @@ import (
 var (
 	outputDir    string // "-test.outputdir"
 	coverProfile string // "-test.coverprofile"
+	goCoverDir   string // "-test.gocoverdir"
+	cpuProfile   string // "-test.cpuprofile"
+	memProfile   string // "-test.memprofile"
 )
 
+// childCoverageProfiles accumulates the coverage profile data handed off by
+// re-executed children through pipes. Instead of merging each child's data
+// into the accumulated data as soon as the child terminates, which would cost
+// a pass over all accumulated blocks per child, the children's (sorted) data
+// gets collected and then merged in batches using a single k-way merge per
+// batch. Any panic while reading handed off data is kept for later, as to not
+// tear down the whole test process from some go routine.
+type childCoverageProfiles struct {
+	mu       sync.Mutex
+	pending  []*coverageProfile // handed off, but not yet merged.
+	panicked interface{}
+	merging  sync.Mutex // serializes merging batches into cp.
+	cp       *coverageProfile
+}
+
+// handOffBatchSize is the number of children's coverage profile data to
+// collect before merging them in one go into the accumulated data.
+const handOffBatchSize = 32
+
+// childCoverage accumulates the coverage profile data handed off by the
+// children of this test process; only the final coverage report merges it.
+var childCoverage childCoverageProfiles
+
+// handOff receives the coverage profile data of a single child and adds it to
+// the coverage profile data to be merged; when a full batch has been
+// collected, handOff merges the batch into the accumulated data.
+func (c *childCoverageProfiles) handOff(r io.Reader) {
+	defer func() {
+		if recovered := recover(); recovered != nil {
+			c.mu.Lock()
+			defer c.mu.Unlock()
+			if c.panicked == nil {
+				c.panicked = recovered
+			}
+		}
+	}()
+	cp := readcov(r)
+	if cp == nil {
+		return
+	}
+	c.mu.Lock()
+	c.pending = append(c.pending, cp)
+	var batch []*coverageProfile
+	if len(c.pending) >= handOffBatchSize {
+		batch = c.pending
+		c.pending = nil
+	}
+	c.mu.Unlock()
+	if batch != nil {
+		c.merge(batch)
+	}
+}
+
+// merge merges the specified batch of children's coverage profile data into
+// the accumulated data.
+func (c *childCoverageProfiles) merge(batch []*coverageProfile) {
+	c.merging.Lock()
+	defer c.merging.Unlock()
+	if c.cp == nil {
+		c.cp = newCoverageProfile()
+	}
+	mergeCoverageProfiles(c.cp, batch)
+}
+
+// profile waits for all children to finish handing off their coverage
+// profile data, merges any remaining data, and then returns the accumulated
+// data, or nil if there is none. It panics if reading any child's data
+// panicked before.
+func (c *childCoverageProfiles) profile() *coverageProfile {
+	testsupport.WaitCoverageHandOffs()
+	c.mu.Lock()
+	if c.panicked != nil {
+		defer c.mu.Unlock()
+		panic(c.panicked)
+	}
+	batch := c.pending
+	c.pending = nil
+	c.mu.Unlock()
+	if batch != nil {
+		c.merge(batch)
+	}
+	c.merging.Lock()
+	defer c.merging.Unlock()
+	return c.cp
+}
+
 // mergeAndReportCoverages picks up the coverage profile data files created by
 // re-executed copies and merges them into this (parent) process' coverage
-// profile data.
-func mergeAndReportCoverages(maincovprof string, childcovprofs []string) {
+// profile data, together with any coverage profile data handed off by
+// children.
+func mergeAndReportCoverages(maincovprof string, childcovprofs []string, handedoff *coverageProfile) {
 	sumcp := coverageProfile{
 		Sources: make(map[string]*coverageProfileSource),
 	}
@@ -40,17 +134,24 @@ func mergeAndReportCoverages(maincovprof string, childcovprofs []string) {
 	mergeCoverageFile(toOutputDir(maincovprof), &sumcp)
 	// ...then merge in the re-executed children's coverage profile data, and
 	// write the results into a file.
-	mergeWithCoverProfileAndReport(&sumcp, childcovprofs, maincovprof)
+	mergeWithCoverProfileAndReport(&sumcp, childcovprofs, handedoff, maincovprof)
 }
 
 // mergeWithCoverProfileAndReport takes a coverage profile, merges in other
-// coverage profile data files, and then writes the summary coverage profile
-// data to the specified file.
-func mergeWithCoverProfileAndReport(sumcp *coverageProfile, childcovprofs []string, mergedname string) {
+// coverage profile data files as well as optional coverage profile data
+// handed off by children, and then writes the summary coverage profile data
+// to the specified file.
+func mergeWithCoverProfileAndReport(sumcp *coverageProfile, childcovprofs []string, handedoff *coverageProfile, mergedname string) {
 	// Merge in other coverage profile data files (typically created by
-	// re-executed child processes).
-	for _, coverprofilename := range childcovprofs {
-		mergeCoverageFile(toOutputDir(coverprofilename), sumcp)
+	// re-executed child processes) all in one go.
+	paths := make([]string, len(childcovprofs))
+	for idx, coverprofilename := range childcovprofs {
+		paths[idx] = toOutputDir(coverprofilename)
+	}
+	mergeCoverageFiles(sumcp, paths)
+	// Merge in the coverage profile data handed off by children directly.
+	if handedoff != nil {
+		mergeCoverageProfiles(sumcp, []*coverageProfile{handedoff})
 	}
 	// Finally dump the summary coverage profile data onto the parent's
 	// coverage profile data, overwriting it.
@@ -71,7 +172,9 @@ func mergeWithCoverProfileAndReport(sumcp *coverageProfile, childcovprofs []stri
 	}
 	sort.Strings(sourcenames)
 	for _, sourcename := range sourcenames {
-		for _, block := range sumcp.Sources[sourcename].Blocks {
+		source := sumcp.Sources[sourcename]
+		for blocks := source.cursor(); blocks.next(); {
+			block := &blocks.block
 			fmt.Fprintf(f, "%s:%d.%d,%d.%d %d %d\n",
 				sourcename,
 				block.StartLine, block.StartCol,
@@ -82,8 +185,9 @@ func mergeWithCoverProfileAndReport(sumcp *coverageProfile, childcovprofs []stri
 	}
 }
 
-// parseCoverageArgs gathers the output directory and cover profile file from
-// the CLI arguments.
+// parseCoverageArgs gathers the output directory, cover profile file, binary
+// coverage data directory, as well as CPU and memory profile files from the
+// CLI arguments.
 func parseCoverageArgs(args []string) {
 	for idx := 0; idx < len(args); idx++ {
 		arg := args[idx]
@@ -91,6 +195,12 @@ func parseCoverageArgs(args []string) {
 			outputDir = strings.SplitN(arg, "=", 2)[1]
 		} else if strings.HasPrefix(arg, "-test.coverprofile=") {
 			coverProfile = strings.SplitN(arg, "=", 2)[1]
+		} else if strings.HasPrefix(arg, "-test.gocoverdir=") {
+			goCoverDir = strings.SplitN(arg, "=", 2)[1]
+		} else if strings.HasPrefix(arg, "-test.cpuprofile=") {
+			cpuProfile = strings.SplitN(arg, "=", 2)[1]
+		} else if strings.HasPrefix(arg, "-test.memprofile=") {
+			memProfile = strings.SplitN(arg, "=", 2)[1]
 		} else if arg == "-args" || arg == "--args" {
 			break
 		}
@@ -19,6 +19,8 @@ import (
 	"io"
 	"io/ioutil"
 	"os"
+	"strings"
+	"sync"
 
 	"github.com/thediveo/gons/reexec"
 
@@ -74,23 +76,33 @@ var _ = Describe("coveraging re-execution", func() {
 		Expect(os.Chmod(tmpdir+"/main.cov", 0400))
 		defer func() { _ = os.Chmod(tmpdir+"/main.cov", 0600) }()
 		Expect(func() {
-			mergeAndReportCoverages(tmpdir+"/main.cov", []string{})
+			mergeAndReportCoverages(tmpdir+"/main.cov", []string{}, nil)
 		}).To(Panic())
 	})
 
 	It("parses coverage-related CLI args", func() {
-		oldod, oldcp := outputDir, coverProfile
-		defer func() { outputDir, coverProfile = oldod, oldcp }()
+		oldod, oldcp, oldcd := outputDir, coverProfile, goCoverDir
+		oldcpu, oldmem := cpuProfile, memProfile
+		defer func() {
+			outputDir, coverProfile, goCoverDir = oldod, oldcp, oldcd
+			cpuProfile, memProfile = oldcpu, oldmem
+		}()
 		arghs := []string{
 			"abc",
 			"-test.outputdir=bar",
 			"-test.coverprofile=foo",
+			"-test.gocoverdir=/baz",
+			"-test.cpuprofile=cpu.pprof",
+			"-test.memprofile=mem.pprof",
 			"-args",
 			"-test.outputdir=xxx",
 		}
 		parseCoverageArgs(arghs)
 		Expect(outputDir).To(Equal("bar"))
 		Expect(coverProfile).To(Equal("foo"))
+		Expect(goCoverDir).To(Equal("/baz"))
+		Expect(cpuProfile).To(Equal("cpu.pprof"))
+		Expect(memProfile).To(Equal("mem.pprof"))
 	})
 
 	It("merges coverage reports and writes merged report", func() {
@@ -101,7 +113,8 @@ var _ = Describe("coveraging re-execution", func() {
 
 		mergeAndReportCoverages(
 			tmpdir+"/main.cov",
-			[]string{"test/cov2.cov"})
+			[]string{"test/cov2.cov"},
+			nil)
 		actualfinalreport, err := ioutil.ReadFile(tmpdir + "/main.cov")
 		Expect(err).NotTo(HaveOccurred())
 		finalreport, err := ioutil.ReadFile("test/final.cov")
@@ -109,4 +122,56 @@ var _ = Describe("coveraging re-execution", func() {
 		Expect(string(actualfinalreport)).To(Equal(string(finalreport)))
 	})
 
+	It("merges coverage profile data handed off by children", func() {
+		tmpdir, err := ioutil.TempDir("", "covreport")
+		Expect(err).NotTo(HaveOccurred())
+		defer os.RemoveAll(tmpdir)
+		copyfile("test/cov1.cov", tmpdir+"/main.cov")
+
+		// Use our own accumulator, keeping the coverage profile data handed
+		// off by the real children of this test process out of the way.
+		var children childCoverageProfiles
+		for _, path := range []string{"test/empty.cov", "test/cov2.cov"} {
+			f, err := os.Open(path)
+			Expect(err).NotTo(HaveOccurred())
+			children.handOff(f)
+			f.Close()
+		}
+		mergeAndReportCoverages(tmpdir+"/main.cov", []string{}, children.profile())
+		actualfinalreport, err := ioutil.ReadFile(tmpdir + "/main.cov")
+		Expect(err).NotTo(HaveOccurred())
+		finalreport, err := ioutil.ReadFile("test/final.cov")
+		Expect(err).NotTo(HaveOccurred())
+		Expect(string(actualfinalreport)).To(Equal(string(finalreport)))
+
+		children.handOff(strings.NewReader("mode: atomic\nfoobar\n"))
+		Expect(func() { _ = children.profile() }).To(Panic())
+	})
+
+	It("merges coverage profile data handed off by lots of children in batches", func() {
+		children := 2*handOffBatchSize + 1
+		paths := make([]string, children)
+		for idx := range paths {
+			paths[idx] = "test/cov2.cov"
+		}
+		want := newCoverageProfile()
+		mergeCoverageFiles(want, paths)
+
+		var handedoff childCoverageProfiles
+		var wg sync.WaitGroup
+		wg.Add(children)
+		for idx := 0; idx < children; idx++ {
+			go func() {
+				defer GinkgoRecover()
+				defer wg.Done()
+				f, err := os.Open("test/cov2.cov")
+				Expect(err).NotTo(HaveOccurred())
+				defer f.Close()
+				handedoff.handOff(f)
+			}()
+		}
+		wg.Wait()
+		Expect(handedoff.profile()).To(Equal(want))
+	})
+
 })
@@ -7,9 +7,37 @@ context of test process re-execution. As testing only writes coverage profile
 data at the end of testing.M.Run(), we need to run testing.M.Run() also on
 re-execution. However, without further measures the resulting coverage profile
 data file of the re-executed child would be overwritten by the parent when it
-finishes its own testing.M.Run(). So we need to run each re-executed child on
-its own coverage profile data file. After testing.M.Run() has finished, we
-then merge the child coverage profile data into the parent's coverage profile
-data file.
+finishes its own testing.M.Run(). So each re-executed child gets its own
+coverage profile data "file", which actually is a pipe back to the parent:
+the parent collects the child coverage profile data as each child terminates
+and merges it in batches. After testing.M.Run() has finished, we then merge
+the children's coverage profile data into the parent's coverage profile data
+file in a single write.
+
+Fortunately, since Go 1.20 things have become much less ugly: when "go test"
+passes a "-test.gocoverdir" binary coverage data directory to the parent, then
+the re-executed children write their binary coverage data into this same
+directory instead of into textual coverage profile data files of their own.
+The parent's testing.M.Run() then merges all binary coverage data found in the
+directory when it writes the coverage profile, so there isn't anything left to
+parse, merge, and rewrite for us. Please note that "go test -cover" always
+passes "-test.gocoverdir" when the redesigned coverage is in effect, and it's
+also how scripts/cov.sh gathers coverage.
+
+When running with "-test.cpuprofile" and/or "-test.memprofile", re-executed
+children additionally profile their actions, writing their profiles next to
+the parent's profiles with the action name and child PID appended to the
+file names. After testing.M.Run() has written the parent's profiles, we merge
+the children's profiles into them and remove the children's profiles, so
+"go tool pprof cpu.out" shows the parent and all its children; the samples
+from the children are labelled with their action names, see
+reexec.ActionProfileLabel. Children exiting inside their actions don't write
+any profiles; any child profiles that cannot be parsed are left behind.
+
+Benchmarks of code that needs to run inside other namespaces, such as a
+container's mount or network namespace, can be registered using
+RegisterBenchmark() and then run inside a re-executed child using
+RunBenchmark(), with the child's ns/op, B/op and allocs/op reported as the
+results of the parent's benchmark.
 */
 package testing
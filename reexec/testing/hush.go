@@ -0,0 +1,41 @@
+// Copyright 2020 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package testing
+
+import (
+	"os"
+)
+
+// hushed runs function f with os.Stdout and os.Stderr sent into early
+// retirement, that is, to /dev/null. This is necessary as some applications
+// using gons/reexec expect the re-executed child to return their results via
+// stdout without any stderr output, so we don't want Golang's testing output
+// (such as "PASS", "coverage: ..." and "testing: warning: ...") to interfere
+// here. Instead of filtering whatever gets written, we simply don't listen:
+// f is only ever testing.M.Run() in a re-executed child after the action has
+// finished, so there is no action output to pass on anyway.
+func hushed(f func()) {
+	devnull, err := os.OpenFile(os.DevNull, os.O_WRONLY, 0)
+	if err != nil {
+		panic("gons/reexec/testing: cannot open " + os.DevNull + ": " + err.Error())
+	}
+	realStdout, realStderr := os.Stdout, os.Stderr
+	os.Stdout, os.Stderr = devnull, devnull
+	defer func() {
+		os.Stdout, os.Stderr = realStdout, realStderr
+		devnull.Close()
+	}()
+	f()
+}
@@ -18,7 +18,6 @@ import (
 	"fmt"
 	"io/ioutil"
 	"os"
-	"strings"
 
 	. "github.com/onsi/ginkgo/v2"
 	. "github.com/onsi/gomega"
@@ -59,37 +58,18 @@ var _ = Describe("stderr processing", func() {
 		Expect(capturestdout(func() { fmt.Fprint(os.Stderr, "foo") })).To(Equal("foo"))
 	})
 
-	It("correctly passes on normal output", func() {
+	It("hushes testing's chatter", func() {
+		realStdout := os.Stdout
 		Expect(capturestdout(func() {
-			pritiPratel(func() {
-				fmt.Fprint(os.Stderr, "some test")
+			fmt.Fprint(os.Stderr, "some test\n")
+			hushed(func() {
+				Expect(os.Stdout == realStdout).To(BeFalse())
+				fmt.Fprint(os.Stdout, "PASS\n")
+				fmt.Fprint(os.Stderr, "coverage: foo\ntesting: foo\n")
 			})
-		})).To(Equal("some test"))
-		Expect(capturestdout(func() {
-			pritiPratel(func() {
-				fmt.Fprint(os.Stderr, "coverage is meh\ntest\n")
-			})
-		})).To(Equal("coverage is meh\ntest\n"))
-		long := strings.Repeat("abc", 1024)
-		Expect(capturestdout(func() {
-			pritiPratel(func() {
-				fmt.Fprint(os.Stderr, long+"\ntest\n")
-			})
-		})).To(Equal(long + "\ntest\n"))
-	})
-
-	It("hides unwanted truths about coverage: and testing:", func() {
-		Expect(capturestdout(func() {
-			pritiPratel(func() {
-				fmt.Fprint(os.Stderr, "some test\ncoverage: foo\nbar\ntesting: foo\nbar")
-			})
-		})).To(Equal("some test\nbar\nbar"))
-		long := strings.Repeat("abc", 1024)
-		Expect(capturestdout(func() {
-			pritiPratel(func() {
-				fmt.Fprint(os.Stderr, "some test\ncoverage: "+long+"\nbar\ntesting: foo\nbar")
-			})
-		})).To(Equal("some test\nbar\nbar"))
+			fmt.Fprint(os.Stderr, "bar")
+		})).To(Equal("some test\nbar"))
+		Expect(os.Stdout == realStdout).To(BeTrue())
 	})
 
 })
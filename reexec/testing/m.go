@@ -70,7 +70,10 @@ func (m *M) run() (exitcode int, reexeced bool) {
 	// it can correctly re-execute child processes under test.
 	parseCoverageArgs(os.Args)
 	if !reexeced {
-		testsupport.EnableTesting(outputDir, coverProfile)
+		testsupport.EnableTesting(outputDir, coverProfile, goCoverDir)
+		testsupport.CoverageHandOff = childCoverage.handOff
+		// Children write their CPU and heap profiles next to ours, if any.
+		testsupport.EnableProfiling(toOutputDir(cpuProfile), toOutputDir(memProfile))
 	}
 	// Run the tests: for the parent this will be an ordinary test run, but
 	// for a re-executed child the passed "-test.run" argument will ensure
@@ -88,15 +91,31 @@ func (m *M) run() (exitcode int, reexeced bool) {
 			}()
 			exitcode = m.M.Run()
 		}()
+		// m.M.Run() has written our CPU and heap profiles, if asked to, so
+		// merge the children's profiles into them.
+		if cpuProfile != "" {
+			mergeChildProfiles(toOutputDir(cpuProfile),
+				testsupport.ChildProfiles(toOutputDir(cpuProfile)))
+		}
+		if memProfile != "" {
+			mergeChildProfiles(toOutputDir(memProfile),
+				testsupport.ChildProfiles(toOutputDir(memProfile)))
+		}
 		// For the parent we finally need to gather the coverage profile data
 		// written by the individual re-executed child processes, and merge it
 		// with our own coverage profile data. Our data has been written at the
 		// end of the (empty) m.M.Run(), so we can only now do the final merge.
-		if coverProfile != "" && exitcode == 0 {
-			mergeAndReportCoverages(coverProfile, testsupport.CoverageProfiles)
+		//
+		// That is, unless the children wrote binary coverage data into our
+		// coverage data directory: then m.M.Run() already picked up their
+		// data when writing our coverage profile and there's nothing left
+		// for us to do.
+		if coverProfile != "" && goCoverDir == "" && exitcode == 0 {
+			childprofs := testsupport.CoverageProfiles()
+			mergeAndReportCoverages(coverProfile, childprofs, childCoverage.profile())
 			// Now clean up!
 			if !m.skipCleanup {
-				for _, coverprof := range testsupport.CoverageProfiles {
+				for _, coverprof := range childprofs {
 					_ = os.Remove(toOutputDir(coverprof))
 				}
 			}
@@ -107,10 +126,19 @@ func (m *M) run() (exitcode int, reexeced bool) {
 		}
 	} else {
 		// Run the empty test set when we're an re-executed child, so that the
-		// Go testing package creates a coverage profile data report.
-		pritiPratel(func() {
+		// Go testing package creates a coverage profile data report. As the
+		// action has already sent its result(s), we don't want testing's
+		// "PASS" on stdout to confuse a parent reading a stream of results,
+		// nor testing's chatter on stderr to fail the re-execution.
+		hushed(func() {
 			exitcode = m.M.Run()
 		})
+		// As we've hushed testing, tell our parent if things went south.
+		if exitcode != 0 && recovered == nil {
+			fmt.Fprintf(os.Stderr,
+				"gons/reexec/testing: re-executed child's testing.M.Run() failed with exit code %d",
+				exitcode)
+		}
 		// If RunAction() panicked, we "recover our panic", but this way the
 		// coverage data has been generated and can later be merged.
 		if recovered != nil {
@@ -1,8 +1,11 @@
 package testing
 
 import (
+	"fmt"
 	gotesting "testing"
 
+	"github.com/thediveo/gons/reexec"
+
 	. "github.com/onsi/ginkgo/v2"
 	. "github.com/onsi/gomega"
 )
@@ -15,3 +18,21 @@ func TestPackage(t *gotesting.T) {
 	RegisterFailHandler(Fail)
 	RunSpecs(t, "gons/reexec/testing package")
 }
+
+// TestParallelReexecution re-executes from parallel tests, which must neither
+// race nor mix up the coverage profile data of the children when under
+// coverage.
+func TestParallelReexecution(t *gotesting.T) {
+	for i := 0; i < 8; i++ {
+		t.Run(fmt.Sprintf("child-%d", i), func(t *gotesting.T) {
+			t.Parallel()
+			var result string
+			if err := reexec.RunReexecAction("foo", reexec.Result(&result)); err != nil {
+				t.Fatal(err)
+			}
+			if result != "foo done" {
+				t.Fatalf("expected %q, got %q", "foo done", result)
+			}
+		})
+	}
+}
@@ -0,0 +1,83 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package testing
+
+import (
+	"fmt"
+	"os"
+
+	"github.com/google/pprof/profile"
+)
+
+// mergeChildProfiles merges the specified CPU or heap profiles written by
+// re-executed children into the profile at path written by this (parent)
+// process, and then removes the merged child profiles. Child profiles that
+// cannot be parsed are skipped and left behind. As profiling is only a
+// nice-to-have, any other problem leaves the profiles alone, and just gets
+// reported on stderr, similar to how testing reports profiling problems.
+func mergeChildProfiles(path string, childprofs []string) {
+	if path == "" || len(childprofs) == 0 {
+		return
+	}
+	parent, err := readProfile(path)
+	if err != nil {
+		fmt.Fprintf(os.Stderr, "gons/reexec/testing: cannot merge child profiles: %s\n", err)
+		return
+	}
+	profs := []*profile.Profile{parent}
+	var merged []string
+	for _, childprof := range childprofs {
+		prof, err := readProfile(childprof)
+		if err != nil {
+			continue
+		}
+		profs = append(profs, prof)
+		merged = append(merged, childprof)
+	}
+	if len(merged) == 0 {
+		return
+	}
+	sum, err := profile.Merge(profs)
+	if err != nil {
+		fmt.Fprintf(os.Stderr, "gons/reexec/testing: cannot merge child profiles into %s: %s\n", path, err)
+		return
+	}
+	f, err := os.Create(path)
+	if err != nil {
+		fmt.Fprintf(os.Stderr, "gons/reexec/testing: cannot merge child profiles: %s\n", err)
+		return
+	}
+	err = sum.Write(f)
+	if cerr := f.Close(); err == nil {
+		err = cerr
+	}
+	if err != nil {
+		fmt.Fprintf(os.Stderr, "gons/reexec/testing: cannot merge child profiles into %s: %s\n", path, err)
+		return
+	}
+	for _, childprof := range merged {
+		_ = os.Remove(childprof)
+	}
+}
+
+// readProfile reads and parses the pprof profile at path.
+func readProfile(path string) (*profile.Profile, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+	return profile.Parse(f)
+}
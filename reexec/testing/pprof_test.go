@@ -0,0 +1,89 @@
+// Copyright 2023 Harald Albrecht.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package testing
+
+import (
+	"os"
+	"path/filepath"
+	"runtime/pprof"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+// writeHeapProfile writes a heap profile the same way as testing's
+// "-test.memprofile" does.
+func writeHeapProfile(path string) {
+	f, err := os.Create(path)
+	ExpectWithOffset(1, err).NotTo(HaveOccurred())
+	defer f.Close()
+	ExpectWithOffset(1, pprof.Lookup("allocs").WriteTo(f, 0)).To(Succeed())
+}
+
+// allocatedObjects returns the total number of allocated objects of the heap
+// profile at path.
+func allocatedObjects(path string) int64 {
+	prof, err := readProfile(path)
+	ExpectWithOffset(1, err).NotTo(HaveOccurred())
+	total := int64(0)
+	for _, sample := range prof.Sample {
+		total += sample.Value[0]
+	}
+	return total
+}
+
+var _ = Describe("child profiles", func() {
+
+	It("merges child profiles into the parent's profile", func() {
+		tmpdir, err := os.MkdirTemp("", "profmerge-*")
+		Expect(err).NotTo(HaveOccurred())
+		defer os.RemoveAll(tmpdir)
+		parent := filepath.Join(tmpdir, "mem.out")
+		writeHeapProfile(parent)
+		children := []string{
+			filepath.Join(tmpdir, "mem.out.foo.1"),
+			filepath.Join(tmpdir, "mem.out.foo.2"),
+		}
+		objects := allocatedObjects(parent)
+		for _, child := range children {
+			writeHeapProfile(child)
+			objects += allocatedObjects(child)
+		}
+		broken := filepath.Join(tmpdir, "mem.out.bar.3")
+		Expect(os.WriteFile(broken, []byte("garbage"), 0o644)).To(Succeed())
+
+		mergeChildProfiles(parent, append(children, broken))
+		Expect(allocatedObjects(parent)).To(Equal(objects))
+		for _, child := range children {
+			Expect(child).NotTo(BeAnExistingFile())
+		}
+		Expect(broken).To(BeAnExistingFile())
+		prof, err := readProfile(parent)
+		Expect(err).NotTo(HaveOccurred())
+		Expect(prof.SampleType).To(HaveLen(4))
+	})
+
+	It("leaves child profiles alone without the parent's profile", func() {
+		tmpdir, err := os.MkdirTemp("", "profmerge-*")
+		Expect(err).NotTo(HaveOccurred())
+		defer os.RemoveAll(tmpdir)
+		child := filepath.Join(tmpdir, "mem.out.foo.1")
+		writeHeapProfile(child)
+		mergeChildProfiles(filepath.Join(tmpdir, "mem.out"), []string{child})
+		Expect(child).To(BeAnExistingFile())
+		Expect(filepath.Join(tmpdir, "mem.out")).NotTo(BeAnExistingFile())
+	})
+
+})
@@ -16,11 +16,16 @@ package testing
 
 import (
 	"bufio"
+	"bytes"
+	"container/heap"
+	"encoding/binary"
 	"fmt"
+	"io"
 	"os"
-	"regexp"
+	"runtime"
 	"sort"
-	"strconv"
+	"sync"
+	"sync/atomic"
 )
 
 // coverageProfile represents coverage profile data for a specific coverage
@@ -40,24 +45,24 @@ func newCoverageProfile() *coverageProfile {
 }
 
 // coverageProfileSource represents the coverage blocks of a single source
-// file.
+// file. As merged coverage profiles easily contain millions of blocks, the
+// blocks are kept sorted in a compact encoding instead of as block structs:
+// each block gets encoded as a sequence of uvarints, namely its start line as
+// the difference to the start line of the block before it, its start column,
+// its end line as the difference to its own start line, its end column, its
+// number of statements, and finally its counts. As these numbers are mostly
+// small, a block typically takes only 6 bytes instead of 20 bytes.
+//
+// Blocks get added unsorted to the pending blocks first, until sortPending
+// sorts them and merges them into the encoded blocks.
 type coverageProfileSource struct {
-	Blocks []coverageProfileBlock // coverage blocks per source file.
-}
-
-// coverageProfileBlockByStart is a type alias for sorting slices of
-// coverageProfileBlocks.
-type coverageProfileBlockByStart []coverageProfileBlock
-
-func (b coverageProfileBlockByStart) Len() int      { return len(b) }
-func (b coverageProfileBlockByStart) Swap(i, j int) { b[i], b[j] = b[j], b[i] }
-func (b coverageProfileBlockByStart) Less(i, j int) bool {
-	bi, bj := b[i], b[j]
-	return bi.StartLine < bj.StartLine ||
-		(bi.StartLine == bj.StartLine && bi.StartCol < bj.StartCol)
+	encoded []byte                 // sorted blocks, encoded.
+	blocks  int                    // number of encoded blocks.
+	pending []coverageProfileBlock // blocks added, but not yet sorted.
 }
 
-// coverageProfileBlock represents a single block of coverage profiling data.
+// coverageProfileBlock represents a single block of coverage profiling data,
+// as read from and written to coverage profile data files.
 type coverageProfileBlock struct {
 	StartLine uint32 // line number for block start.
 	StartCol  uint16 // column number for block start.
@@ -67,54 +72,326 @@ type coverageProfileBlock struct {
 	Counts    uint32 // number of times this block was executed.
 }
 
-// modeRe specifies the format of the first "mode:" text line of a coverage
-// profile data file.
-var modeRe = regexp.MustCompile(`^mode: ([[:alpha:]]+)$`)
+// before reports whether block a comes before block b. Blocks are ordered by
+// their start positions, and for the same start position by their end
+// positions, so that blocks for the same code location always end up adjacent
+// to each other.
+func before(a, b *coverageProfileBlock) bool {
+	if a.StartLine != b.StartLine {
+		return a.StartLine < b.StartLine
+	}
+	if a.StartCol != b.StartCol {
+		return a.StartCol < b.StartCol
+	}
+	if a.EndLine != b.EndLine {
+		return a.EndLine < b.EndLine
+	}
+	return a.EndCol < b.EndCol
+}
+
+// same reports whether blocks a and b cover the same code location.
+func same(a, b *coverageProfileBlock) bool {
+	return a.StartLine == b.StartLine && a.StartCol == b.StartCol &&
+		a.EndLine == b.EndLine && a.EndCol == b.EndCol
+}
+
+// Len returns the number of sorted blocks of this source, not counting any
+// pending blocks.
+func (s *coverageProfileSource) Len() int { return s.blocks }
+
+// add adds the specified block to the pending blocks.
+func (s *coverageProfileSource) add(block coverageProfileBlock) {
+	s.pending = append(s.pending, block)
+}
+
+// cursor returns a cursor for iterating over the sorted blocks of this
+// source.
+func (s *coverageProfileSource) cursor() blockCursor {
+	return blockCursor{encoded: s.encoded}
+}
+
+// sortPending sorts the pending blocks and merges them into the sorted blocks,
+// where multiple coverages for the same code location get merged into a single
+// block. In set mode, counts get or'ed, otherwise added.
+func (s *coverageProfileSource) sortPending(setmode bool) {
+	if len(s.pending) == 0 {
+		return
+	}
+	pending := s.pending
+	s.pending = nil
+	sort.Slice(pending, func(i, j int) bool { return before(&pending[i], &pending[j]) })
+	enc := blockEncoder{setmode: setmode}
+	for idx := range pending {
+		enc.put(&pending[idx])
+	}
+	run := &coverageProfileSource{}
+	run.encoded, run.blocks = enc.finish()
+	if s.blocks == 0 {
+		s.encoded, s.blocks = run.encoded, run.blocks
+		return
+	}
+	s.merge([]*coverageProfileSource{run}, setmode)
+}
+
+// merge merges the specified sorted runs of coverage blocks for the same
+// source into the sorted blocks of this source, where multiple coverages for
+// the same code location get merged into a single block. In set mode, counts
+// get or'ed, otherwise added.
+//
+// As to not need a second copy of the (potentially large) blocks of this
+// source, merge works in place: it first moves the encoded blocks of this
+// source towards the end of their buffer, making room for the encoded blocks
+// of the runs. Encoding a merged block never takes more bytes than the blocks
+// it was merged from, so the merged blocks never overtake the blocks of this
+// source still to be decoded. Only when the buffer lacks room, it gets
+// replaced by a larger one, with some headroom for later merges.
+func (s *coverageProfileSource) merge(runs []*coverageProfileSource, setmode bool) {
+	room := 0
+	for _, run := range runs {
+		room += len(run.encoded)
+	}
+	if room == 0 {
+		return
+	}
+	size := len(s.encoded) + room
+	buf := s.encoded[:cap(s.encoded)]
+	own := s.cursor()
+	if len(buf) >= size {
+		copy(buf[room:], s.encoded)
+		own.encoded = buf[room:size]
+	} else {
+		buf = make([]byte, size+size/4)
+	}
+	// Set up the heap of runs, leaving out any empty runs.
+	h := make(blockRunHeap, 0, len(runs)+1)
+	for _, cursor := range append([]blockCursor{own}, cursorsOf(runs)...) {
+		if cursor.next() {
+			h = append(h, cursor)
+		}
+	}
+	heap.Init(&h)
+	enc := blockEncoder{encoded: buf[:0], setmode: setmode}
+	for len(h) > 0 {
+		enc.put(&h[0].block)
+		if h[0].next() {
+			heap.Fix(&h, 0)
+		} else {
+			heap.Pop(&h)
+		}
+	}
+	s.encoded, s.blocks = enc.finish()
+}
+
+// cursorsOf returns cursors for the specified runs of coverage blocks.
+func cursorsOf(runs []*coverageProfileSource) []blockCursor {
+	cursors := make([]blockCursor, len(runs))
+	for idx, run := range runs {
+		cursors[idx] = run.cursor()
+	}
+	return cursors
+}
+
+// blockCursor decodes encoded coverage blocks one after another.
+type blockCursor struct {
+	encoded []byte               // encoded blocks not yet decoded.
+	block   coverageProfileBlock // most recently decoded block.
+}
+
+// next decodes the next block, returning false if there are no more blocks.
+func (c *blockCursor) next() bool {
+	if len(c.encoded) == 0 {
+		return false
+	}
+	c.block.StartLine += uint32(c.uvarint())
+	c.block.StartCol = uint16(c.uvarint())
+	c.block.EndLine = c.block.StartLine + uint32(c.uvarint())
+	c.block.EndCol = uint16(c.uvarint())
+	c.block.NumStmts = uint16(c.uvarint())
+	c.block.Counts = uint32(c.uvarint())
+	return true
+}
+
+// uvarint decodes the next uvarint.
+func (c *blockCursor) uvarint() uint64 {
+	v, n := binary.Uvarint(c.encoded)
+	c.encoded = c.encoded[n:]
+	return v
+}
+
+// blockEncoder encodes sorted coverage blocks, merging multiple coverages for
+// the same code location into a single block.
+type blockEncoder struct {
+	encoded   []byte
+	blocks    int
+	setmode   bool
+	last      coverageProfileBlock // most recent block, not yet encoded.
+	haslast   bool
+	startline uint32 // start line of the most recently encoded block.
+}
 
-// lineRe specifies the format of the block text lines in coverage profile
-// data files.
-var lineRe = regexp.MustCompile(
-	`^(.+):([0-9]+).([0-9]+),([0-9]+).([0-9]+) ([0-9]+) ([0-9]+)$`)
+// put adds the specified block, which must not come before the most recent
+// block.
+func (e *blockEncoder) put(block *coverageProfileBlock) {
+	if e.haslast && same(&e.last, block) {
+		// We've found a(nother) matching code block, so update the not yet
+		// encoded block's coverage data.
+		if e.setmode {
+			e.last.Counts |= block.Counts
+		} else {
+			e.last.Counts += block.Counts
+		}
+		return
+	}
+	e.flush()
+	e.last, e.haslast = *block, true
+}
+
+// flush encodes the most recent block, if any.
+func (e *blockEncoder) flush() {
+	if !e.haslast {
+		return
+	}
+	e.encoded = binary.AppendUvarint(e.encoded, uint64(e.last.StartLine-e.startline))
+	e.encoded = binary.AppendUvarint(e.encoded, uint64(e.last.StartCol))
+	e.encoded = binary.AppendUvarint(e.encoded, uint64(e.last.EndLine-e.last.StartLine))
+	e.encoded = binary.AppendUvarint(e.encoded, uint64(e.last.EndCol))
+	e.encoded = binary.AppendUvarint(e.encoded, uint64(e.last.NumStmts))
+	e.encoded = binary.AppendUvarint(e.encoded, uint64(e.last.Counts))
+	e.startline = e.last.StartLine
+	e.blocks++
+	e.haslast = false
+}
+
+// finish encodes the most recent block, if any, and returns the encoded blocks
+// as well as their number.
+func (e *blockEncoder) finish() ([]byte, int) {
+	e.flush()
+	return e.encoded, e.blocks
+}
 
 // mergeCoverageFile reads coverage profile data from the file specified in
 // the path parameter and merges it with the summary coverage profile in
 // sumcp.
 func mergeCoverageFile(path string, sumcp *coverageProfile) {
-	// Phase I: read in the specified coverage profile data file, before we
-	// can attempt to merge it.
-	cp := readcovfile(path)
-	if cp == nil {
-		return
-	}
+	mergeCoverageFiles(sumcp, []string{path})
+}
+
+// mergeCoverageFiles reads coverage profile data from all the files specified
+// in the paths parameter and merges them with the summary coverage profile in
+// sumcp. Instead of repeatedly appending and then re-sorting the ever-growing
+// summary blocks for each and every file, the blocks of each file get sorted
+// only once and then all files are merged in a single k-way merge per source.
+// As sources are independent of each other, they get merged in parallel.
+func mergeCoverageFiles(sumcp *coverageProfile, paths []string) {
+	// Phase I: read in (and sort) the specified coverage profile data files,
+	// before we can attempt to merge them.
+	mergeCoverageProfiles(sumcp, readcovfiles(paths))
+}
+
+// mergeCoverageProfiles merges the specified coverage profiles into the
+// summary coverage profile in sumcp, sorting any pending blocks first. Nil
+// coverage profiles are skipped.
+func mergeCoverageProfiles(sumcp *coverageProfile, cps []*coverageProfile) {
 	// Phase II: check for the proper coverage profile mode; if not set yet
-	// for the results, then accept the one from the coverage profile just
+	// for the results, then accept the one from the first coverage profile
 	// read. Normally, this will be the "main" coverage profile file created
 	// by the process under test, as we'll read in the other profiles from
 	// re-executed children only later.
-	if sumcp.Mode == "" {
-		sumcp.Mode = cp.Mode
-	} else if cp.Mode != sumcp.Mode {
-		panic(fmt.Sprintf("expected mode %q, got mode %q", sumcp.Mode, cp.Mode))
+	for _, cp := range cps {
+		if cp == nil {
+			continue
+		}
+		if sumcp.Mode == "" {
+			sumcp.Mode = cp.Mode
+		} else if cp.Mode != sumcp.Mode {
+			panic(fmt.Sprintf("expected mode %q, got mode %q", sumcp.Mode, cp.Mode))
+		}
 	}
-	// Phase III: for each source, append the new blocks to the existing ones,
-	// sort them, and then finally merge blocks.
+	// Phase III: gather the sorted runs of blocks per source to be merged
+	// into the summary's own blocks. Blocks normally are already sorted,
+	// unless someone handed us a fresh coverage profile with pending blocks
+	// in random order.
 	setmode := sumcp.Mode == "set"
-	for srcname, source := range cp.Sources {
-		// Look up the corresponding source in the summary coverage profile,
-		// or create a new one, if not already present.
-		var sumsource *coverageProfileSource
-		var ok bool
-		if sumsource, ok = sumcp.Sources[srcname]; !ok {
-			sumsource = &coverageProfileSource{Blocks: source.Blocks}
-			sumcp.Sources[srcname] = sumsource
-		} else {
-			sumsource.Blocks = append(sumsource.Blocks, source.Blocks...)
+	for _, source := range sumcp.Sources {
+		source.sortPending(setmode)
+	}
+	runs := map[string][]*coverageProfileSource{}
+	for _, cp := range cps {
+		if cp == nil {
+			continue
+		}
+		for srcname, source := range cp.Sources {
+			source.sortPending(setmode)
+			runs[srcname] = append(runs[srcname], source)
 		}
-		// We might not merge, but we do sort anyway. While not strictly
-		// necessary, this helps our tests to have a well-defined result
-		// order.
-		mergecovblocks(sumsource, setmode)
 	}
+	// Phase IV: k-way merge the runs per source in place into the summary's
+	// blocks, with the sources being merged in parallel. In order to not
+	// write to the sources map from multiple go routines, we create any
+	// missing sources beforehand.
+	srcnames := make(chan string, len(runs))
+	for srcname := range runs {
+		if _, ok := sumcp.Sources[srcname]; !ok {
+			sumcp.Sources[srcname] = &coverageProfileSource{}
+		}
+		srcnames <- srcname
+	}
+	close(srcnames)
+	workers := runtime.GOMAXPROCS(0)
+	if workers > len(runs) {
+		workers = len(runs)
+	}
+	var wg sync.WaitGroup
+	wg.Add(workers)
+	for w := 0; w < workers; w++ {
+		go func() {
+			defer wg.Done()
+			for srcname := range srcnames {
+				sumcp.Sources[srcname].merge(runs[srcname], setmode)
+			}
+		}()
+	}
+	wg.Wait()
+}
+
+// readcovfiles reads the specified coverage profile data files in parallel,
+// returning their coverageProfiles. Files that don't exist or are empty
+// result in nil coverageProfiles. If any file turns out to be unparseable,
+// readcovfiles panics in the caller's go routine, as to not tear down the
+// whole process.
+func readcovfiles(paths []string) []*coverageProfile {
+	cps := make([]*coverageProfile, len(paths))
+	workers := runtime.GOMAXPROCS(0)
+	if workers > len(paths) {
+		workers = len(paths)
+	}
+	var next int64 = -1
+	var wg sync.WaitGroup
+	var panicked sync.Once
+	var panicval interface{}
+	wg.Add(workers)
+	for w := 0; w < workers; w++ {
+		go func() {
+			defer wg.Done()
+			defer func() {
+				if r := recover(); r != nil {
+					panicked.Do(func() { panicval = r })
+				}
+			}()
+			for {
+				idx := int(atomic.AddInt64(&next, 1))
+				if idx >= len(paths) {
+					return
+				}
+				cps[idx] = readcovfile(paths[idx])
+			}
+		}()
+	}
+	wg.Wait()
+	if panicval != nil {
+		panic(panicval)
+	}
+	return cps
 }
 
 // readcovfile reads a coverage profile data file and returns it as a
@@ -134,111 +411,190 @@ func readcovfile(path string) *coverageProfile {
 			toOutputDir(path), err.Error()))
 	}
 	defer cpf.Close()
-	scan := bufio.NewScanner(cpf)
-	if !scan.Scan() {
+	return readcov(cpf)
+}
+
+// readcov reads coverage profile data from the specified reader and returns
+// it as a coverageProfile with the blocks of each source sorted, or nil if
+// there isn't any data. If the data turns out to be unparseable, it panics.
+//
+// As large coverage profile data files easily contain millions of blocks, we
+// don't use regular expressions and don't allocate per line, but instead
+// parse lines in place inside the buffer of a bufio.Reader. Source file names
+// get interned, so they are allocated only once per source.
+func readcov(rd io.Reader) *coverageProfile {
+	r := bufio.NewReaderSize(rd, 64*1024)
+	line, ok := readcovline(r)
+	if !ok {
 		return nil
 	}
-	// Phase I: read in the specified coverage profile data file, before we
-	// can attempt to merge it.
 	cp := newCoverageProfile()
 	// The first line of a coverage profile data file is the mode how
 	// coverage data was gathered; either "atomic", "count", or "set".
-	line := scan.Text()
-	m := modeRe.FindStringSubmatch(line)
-	if m == nil {
-		panic(fmt.Sprintf(
-			"line %q doesn't match expected mode: line format", line))
-	}
-	cp.Mode = m[1]
+	cp.Mode = parsecovmode(line)
+	setmode := cp.Mode == "set"
 	// The remaining lines contain coverage profile block data. We optimize
 	// here on the basis that Go's testing/coverage.go writes coverage profile
 	// data files where the coverage block data for the same source file is
 	// continuous (instead of being scattered around). However, the code
 	// blocks are not sorted.
-	var srcname string                // caches most recent source filename.
+	var srcname []byte                // caches most recent source filename.
 	var source *coverageProfileSource // caches most recent source data.
-	for scan.Scan() {
-		line = scan.Text()
-		m := lineRe.FindStringSubmatch(line)
-		if m == nil {
+	for {
+		line, ok := readcovline(r)
+		if !ok {
+			break
+		}
+		name, block, ok := parsecovblock(line)
+		if !ok {
 			panic(fmt.Sprintf(
 				"line %q doesn't match expected block line format", line))
 		}
-		if m[1] != srcname {
-			// If we haven't seen this source filename yet, allocate a
-			// coverage data source element and put into the map of known
-			// sources.
-			srcname = m[1]
-			source = &coverageProfileSource{}
-			cp.Sources[srcname] = source
+		if source == nil || !bytes.Equal(name, srcname) {
+			// Sort the blocks of the previous source already, so that the
+			// unsorted blocks of only a single source pile up at a time.
+			if source != nil {
+				source.sortPending(setmode)
+			}
+			// Map lookups with a converted []byte key don't allocate, so we
+			// allocate the source filename only for sources we haven't seen
+			// yet.
+			if source = cp.Sources[string(name)]; source == nil {
+				source = &coverageProfileSource{}
+				cp.Sources[string(name)] = source
+			}
+			// The reader's buffer gets overwritten by subsequent reads, so
+			// we need our own copy of the source filename to compare with.
+			srcname = append(srcname[:0], name...)
 		}
-		// Append the block data from the coverage profile data file line, the
+		// Add the block data from the coverage profile data file line, the
 		// sequence of blocks is yet unsorted.
-		source.Blocks = append(source.Blocks, coverageProfileBlock{
-			StartLine: toUint32(m[2]),
-			StartCol:  toUint16(m[3]),
-			EndLine:   toUint32(m[4]),
-			EndCol:    toUint16(m[5]),
-			NumStmts:  toUint16(m[6]),
-			Counts:    toUint32(m[7]),
-		})
+		source.add(block)
+	}
+	for _, source := range cp.Sources {
+		source.sortPending(setmode)
 	}
 	return cp
 }
 
-// toUint32 converts a textual int value into its binary uint32
-// representation. If the specified text doesn't represent a valid uint32
-// value, toUint32 panics.
-func toUint32(s string) uint32 {
-	if v, err := strconv.ParseUint(s, 10, 32); err != nil {
-		panic(err.Error())
-	} else {
-		return uint32(v)
+// readcovline returns the next line without its line terminator from the
+// specified reader, or false at the end of the file. The line returned is
+// only valid until the next read. Only lines longer than the reader's buffer
+// need to be assembled in a separate allocation.
+func readcovline(r *bufio.Reader) ([]byte, bool) {
+	line, err := r.ReadSlice('\n')
+	if err == bufio.ErrBufferFull {
+		longline := append([]byte(nil), line...)
+		for err == bufio.ErrBufferFull {
+			line, err = r.ReadSlice('\n')
+			longline = append(longline, line...)
+		}
+		line = longline
+	}
+	if err != nil && err != io.EOF {
+		panic("cannot read coverage profile data: " + err.Error())
 	}
+	if len(line) == 0 {
+		return nil, false
+	}
+	if line[len(line)-1] == '\n' {
+		line = line[:len(line)-1]
+	}
+	return line, true
 }
 
-// toUint16 converts a textual int value into its binary uint16
-// representation. If the specified text doesn't represent a valid uint16
-// value, toUint16 panics.
-func toUint16(s string) uint16 {
-	if v, err := strconv.ParseUint(s, 10, 16); err != nil {
-		panic(err.Error())
-	} else {
-		return uint16(v)
-	}
-}
-
-// mergecovblocks merges coverage blocks for the same code blocks.
-func mergecovblocks(sumsource *coverageProfileSource, setmode bool) {
-	// First sort, so that multiple coverages for the same block location will
-	// be adjacent.
-	sort.Sort(coverageProfileBlockByStart(sumsource.Blocks))
-	mergeidx := 0
-	for idx := mergeidx + 1; idx < len(sumsource.Blocks); idx++ {
-		mergeblock := &sumsource.Blocks[mergeidx]
-		block := &sumsource.Blocks[idx]
-		if mergeblock.StartLine == block.StartLine &&
-			mergeblock.StartCol == block.StartCol &&
-			mergeblock.EndLine == block.EndLine &&
-			mergeblock.EndCol == block.EndCol {
-			// We've found a(nother) matching code block, so update the
-			// first's coverage data.
-			if setmode {
-				mergeblock.Counts |= block.Counts
-			} else {
-				mergeblock.Counts += block.Counts
-			}
-			continue
+// parsecovmode parses the first "mode: " text line of a coverage profile data
+// file, returning the mode. If the line is malformed, it panics.
+func parsecovmode(line []byte) string {
+	mode := bytes.TrimPrefix(line, []byte("mode: "))
+	valid := len(mode) > 0 && len(mode) < len(line)
+	for _, ch := range mode {
+		if !('a' <= ch && ch <= 'z' || 'A' <= ch && ch <= 'Z') {
+			valid = false
+			break
 		}
-		// We've reached a different code location after a set of mergeable
-		// locations, so move this new location block downwards to the end of
-		// already merged blocks.
-		mergeidx++
-		if mergeidx != idx {
-			sumsource.Blocks[mergeidx] = *block
+	}
+	if !valid {
+		panic(fmt.Sprintf(
+			"line %q doesn't match expected mode: line format", line))
+	}
+	return string(mode)
+}
+
+// parsecovblock parses a block text line of the form
+// "name:startline.startcol,endline.endcol numstmts counts", returning the
+// source file name (still inside the line) and the block data. As source file
+// names might contain colons and even spaces, the line is parsed from its end
+// towards its beginning. It returns false if the line is malformed or any of
+// the numbers overflows.
+func parsecovblock(line []byte) (name []byte, block coverageProfileBlock, ok bool) {
+	var v uint64
+	rest := line
+	if v, rest, ok = lastcovnum(rest, ' ', 32); !ok {
+		return
+	}
+	block.Counts = uint32(v)
+	if v, rest, ok = lastcovnum(rest, ' ', 16); !ok {
+		return
+	}
+	block.NumStmts = uint16(v)
+	if v, rest, ok = lastcovnum(rest, '.', 16); !ok {
+		return
+	}
+	block.EndCol = uint16(v)
+	if v, rest, ok = lastcovnum(rest, ',', 32); !ok {
+		return
+	}
+	block.EndLine = uint32(v)
+	if v, rest, ok = lastcovnum(rest, '.', 16); !ok {
+		return
+	}
+	block.StartCol = uint16(v)
+	if v, rest, ok = lastcovnum(rest, ':', 32); !ok {
+		return
+	}
+	block.StartLine = uint32(v)
+	if len(rest) == 0 {
+		return nil, block, false
+	}
+	return rest, block, true
+}
+
+// lastcovnum decodes the unsigned decimal number at the end of the specified
+// text, which must be preceded by the specified separator. It returns the
+// number, the text before the separator, and true if the number is valid and
+// fits into the specified number of bits.
+func lastcovnum(text []byte, sep byte, bits uint) (uint64, []byte, bool) {
+	idx := len(text)
+	for idx > 0 && '0' <= text[idx-1] && text[idx-1] <= '9' {
+		idx--
+	}
+	digits := len(text) - idx
+	if digits == 0 || digits > 20 || idx == 0 || text[idx-1] != sep {
+		return 0, nil, false
+	}
+	var v uint64
+	for _, ch := range text[idx:] {
+		d := uint64(ch - '0')
+		if v > (1<<bits-1-d)/10 {
+			return 0, nil, false
 		}
+		v = v*10 + d
 	}
-	// Shorten the code block locations slice to only, erm, "cover" the unique
-	// (and probably merged) blocks.
-	sumsource.Blocks = sumsource.Blocks[:mergeidx+1]
+	return v, text[:idx-1], true
+}
+
+// blockRunHeap is a min-heap of cursors of (non-exhausted) sorted runs of
+// coverage blocks, ordered by the most recently decoded block of each run.
+type blockRunHeap []blockCursor
+
+func (h blockRunHeap) Len() int            { return len(h) }
+func (h blockRunHeap) Less(i, j int) bool  { return before(&h[i].block, &h[j].block) }
+func (h blockRunHeap) Swap(i, j int)       { h[i], h[j] = h[j], h[i] }
+func (h *blockRunHeap) Push(x interface{}) { *h = append(*h, x.(blockCursor)) }
+func (h *blockRunHeap) Pop() interface{} {
+	old := *h
+	cursor := old[len(old)-1]
+	*h = old[:len(old)-1]
+	return cursor
 }
@@ -15,7 +15,15 @@
 package testing
 
 import (
+	"bufio"
+	"fmt"
+	"math/rand"
 	"os"
+	"path/filepath"
+	"regexp"
+	"sort"
+	"strconv"
+	gotesting "testing"
 
 	. "github.com/onsi/ginkgo/v2"
 	. "github.com/onsi/gomega"
@@ -58,8 +66,8 @@ var _ = Describe("coverage profile data", func() {
 		Expect(cp.Sources).To(HaveLen(2))
 		Expect(cp.Sources).To(HaveKey("a/b.go"))
 		Expect(cp.Sources).To(HaveKey("a/c.go"))
-		Expect(cp.Sources["a/b.go"].Blocks).To(HaveLen(2))
-		Expect(cp.Sources["a/b.go"].Blocks[0]).To(Equal(coverageProfileBlock{
+		Expect(cp.Sources["a/b.go"].Len()).To(Equal(2))
+		Expect(blocksOf(cp.Sources["a/b.go"])[0]).To(Equal(coverageProfileBlock{
 			StartLine: 1,
 			StartCol:  0,
 			EndLine:   2,
@@ -80,10 +88,10 @@ var _ = Describe("coverage profile data", func() {
 		Expect(func() { mergeCoverageFile("test/cov1.cov", cp) }).NotTo(Panic())
 		Expect(func() { mergeCoverageFile("test/cov2.cov", cp) }).NotTo(Panic())
 		Expect(cp.Sources).To(HaveLen(3))
-		Expect(cp.Sources["a/b.go"].Blocks).To(HaveLen(2))
-		Expect(cp.Sources["a/c.go"].Blocks).To(HaveLen(1))
-		Expect(cp.Sources["a/d.go"].Blocks).To(HaveLen(2))
-		Expect(cp.Sources["a/b.go"].Blocks[0]).To(Equal(coverageProfileBlock{
+		Expect(cp.Sources["a/b.go"].Len()).To(Equal(2))
+		Expect(cp.Sources["a/c.go"].Len()).To(Equal(1))
+		Expect(cp.Sources["a/d.go"].Len()).To(Equal(2))
+		Expect(blocksOf(cp.Sources["a/b.go"])[0]).To(Equal(coverageProfileBlock{
 			StartLine: 1,
 			StartCol:  0,
 			EndLine:   2,
@@ -98,7 +106,7 @@ var _ = Describe("coverage profile data", func() {
 		Expect(func() { mergeCoverageFile("test/set.cov", cp) }).NotTo(Panic())
 		Expect(func() { mergeCoverageFile("test/set.cov", cp) }).NotTo(Panic())
 		Expect(cp.Sources).To(HaveLen(2))
-		Expect(cp.Sources["a/b.go"].Blocks[0]).To(Equal(coverageProfileBlock{
+		Expect(blocksOf(cp.Sources["a/b.go"])[0]).To(Equal(coverageProfileBlock{
 			StartLine: 1,
 			StartCol:  0,
 			EndLine:   2,
@@ -108,4 +116,366 @@ var _ = Describe("coverage profile data", func() {
 		}))
 	})
 
+	It("merges many coverage profile data files at once", func() {
+		tmpdir, err := os.MkdirTemp("", "covmerge-*")
+		Expect(err).NotTo(HaveOccurred())
+		defer os.RemoveAll(tmpdir)
+		// Create lots of coverage profile data files with overlapping blocks
+		// in random order, as would have been written by multiple children.
+		rnd := rand.New(rand.NewSource(42))
+		paths := make([]string, 50)
+		for idx := range paths {
+			paths[idx] = filepath.Join(tmpdir, fmt.Sprintf("%d.cov", idx))
+			f, err := os.Create(paths[idx])
+			Expect(err).NotTo(HaveOccurred())
+			fmt.Fprintln(f, "mode: atomic")
+			for _, block := range rnd.Perm(200) {
+				fmt.Fprintf(f, "a/%d.go:%d.%d,%d.42 1 %d\n",
+					block%7, block/3, block%3, block/3+1, rnd.Intn(10))
+			}
+			Expect(f.Close()).To(Succeed())
+		}
+		// The k-way merge must give the same result as the original
+		// append-and-resort merge. Please note that different blocks of the
+		// same source never start at the same position, as otherwise the
+		// original merge wouldn't give well-defined results.
+		paths = append([]string{"test/cov1.cov"}, paths...)
+		mode, want := mergeCoverageFilesResort(paths)
+		cp := newCoverageProfile()
+		mergeCoverageFile(paths[0], cp)
+		mergeCoverageFiles(cp, paths[1:])
+		Expect(cp.Mode).To(Equal(mode))
+		Expect(cp.Mode).To(Equal("atomic"))
+		Expect(cp.Sources).To(HaveLen(len(want)))
+		for srcname, blocks := range want {
+			Expect(cp.Sources).To(HaveKey(srcname))
+			source := cp.Sources[srcname]
+			Expect(blocksOf(source)).To(Equal(blocks), srcname)
+		}
+
+		Expect(func() {
+			mergeCoverageFiles(newCoverageProfile(),
+				[]string{paths[1], "test/broken1.cov", paths[2]})
+		}).To(Panic())
+	})
+
+	It("parses the same as the regexp-based parser", func() {
+		tmpdir, err := os.MkdirTemp("", "covparse-*")
+		Expect(err).NotTo(HaveOccurred())
+		defer os.RemoveAll(tmpdir)
+		large := filepath.Join(tmpdir, "large.cov")
+		writeLargeCoverageProfile(large, 10000)
+		for _, path := range []string{
+			"test/cov1.cov", "test/cov2.cov", "test/set.cov", large,
+		} {
+			Expect(readcovfile(path)).To(Equal(readcovfileRegexp(path)), path)
+		}
+		for _, path := range []string{
+			"test/modeless.cov",
+			"test/broken1.cov", "test/broken2.cov", "test/broken3.cov",
+		} {
+			Expect(func() { readcovfileRegexp(path) }).To(Panic())
+			Expect(func() { readcovfile(path) }).To(Panic(), path)
+		}
+	})
+
+	It("packs blocks", func() {
+		source := &coverageProfileSource{}
+		block := coverageProfileBlock{
+			StartLine: 4294901760,
+			StartCol:  65535,
+			EndLine:   4294967295,
+			EndCol:    65535,
+			NumStmts:  65535,
+			Counts:    4294967295,
+		}
+		source.add(block)
+		huge := coverageProfileBlock{StartLine: 1, EndLine: 4294967295, NumStmts: 1}
+		source.add(huge)
+		backwards := coverageProfileBlock{StartLine: 2, EndLine: 1, NumStmts: 1}
+		source.add(backwards)
+		source.sortPending(false)
+		Expect(source.Len()).To(Equal(3))
+		Expect(blocksOf(source)).To(Equal([]coverageProfileBlock{huge, backwards, block}))
+
+		typical := &coverageProfileSource{}
+		for idx := 0; idx < 1000; idx++ {
+			typical.add(coverageProfileBlock{
+				StartLine: uint32(idx * 3),
+				StartCol:  uint16(idx % 80),
+				EndLine:   uint32(idx*3 + 2),
+				EndCol:    uint16(idx % 60),
+				NumStmts:  uint16(idx%5 + 1),
+				Counts:    uint32(idx % 3),
+			})
+		}
+		typical.sortPending(false)
+		Expect(typical.Len()).To(Equal(1000))
+		Expect(len(typical.encoded)).To(Equal(6 * 1000))
+	})
+
+	It("merges in place", func() {
+		rnd := rand.New(rand.NewSource(42))
+		randomBlocks := func(n int) []coverageProfileBlock {
+			blocks := make([]coverageProfileBlock, n)
+			for idx := range blocks {
+				line := uint32(rnd.Intn(100000))
+				blocks[idx] = coverageProfileBlock{
+					StartLine: line,
+					StartCol:  uint16(rnd.Intn(3)),
+					EndLine:   line + uint32(rnd.Intn(2)),
+					EndCol:    42,
+					NumStmts:  1,
+					Counts:    uint32(rnd.Intn(1000)),
+				}
+			}
+			return blocks
+		}
+		want := map[coverageProfileBlock]uint32{}
+		sum := &coverageProfileSource{}
+		for _, block := range randomBlocks(20000) {
+			sum.add(block)
+			want[coverageProfileBlock{
+				StartLine: block.StartLine, StartCol: block.StartCol,
+				EndLine: block.EndLine, EndCol: block.EndCol, NumStmts: 1,
+			}] += block.Counts
+		}
+		sum.sortPending(false)
+		Expect(sum.Len()).To(Equal(len(want)))
+		// Merge lots of smaller runs in multiple rounds, making sure that at
+		// least some of the rounds reuse the buffer of the merged blocks.
+		reused := 0
+		for round := 0; round < 20; round++ {
+			runs := make([]*coverageProfileSource, 3)
+			for idx := range runs {
+				runs[idx] = &coverageProfileSource{}
+				for _, block := range randomBlocks(100) {
+					runs[idx].add(block)
+					want[coverageProfileBlock{
+						StartLine: block.StartLine, StartCol: block.StartCol,
+						EndLine: block.EndLine, EndCol: block.EndCol, NumStmts: 1,
+					}] += block.Counts
+				}
+				runs[idx].sortPending(false)
+			}
+			buf := &sum.encoded[0]
+			sum.merge(runs, false)
+			if &sum.encoded[0] == buf {
+				reused++
+			}
+		}
+		Expect(reused).NotTo(BeZero())
+		got := blocksOf(sum)
+		Expect(got).To(HaveLen(len(want)))
+		Expect(sort.SliceIsSorted(got, func(i, j int) bool {
+			return before(&got[i], &got[j])
+		})).To(BeTrue())
+		for _, block := range got {
+			counts := block.Counts
+			block.Counts = 0
+			Expect(counts).To(Equal(want[block]), "%+v", block)
+		}
+	})
+
+	It("reads blocks spanning lots of lines", func() {
+		tmpdir, err := os.MkdirTemp("", "covspan-*")
+		Expect(err).NotTo(HaveOccurred())
+		defer os.RemoveAll(tmpdir)
+		path := filepath.Join(tmpdir, "span.cov")
+		Expect(os.WriteFile(path,
+			[]byte("mode: set\na.go:1.1,100000.2 3 1\na.go:1.1,2.2 1 0\n"), 0o644)).To(Succeed())
+		cp := readcovfile(path)
+		Expect(cp).NotTo(BeNil())
+		source := cp.Sources["a.go"]
+		Expect(source.Len()).To(Equal(2))
+		Expect(blocksOf(source)[1].EndLine).To(Equal(uint32(100000)))
+	})
+
+	It("rejects malformed block lines", func() {
+		for _, line := range []string{
+			"", "a/b.go", ":1.0,2.42 3 456", "a/b.go:1.0,2.42 3",
+			"a/b.go:1.0,2.42 3 456 ", "a/b.go:1.0;2.42 3 456",
+			"a/b.go:1.0,2.42 3 4294967296", "a/b.go:1.65536,2.42 3 456",
+		} {
+			_, _, ok := parsecovblock([]byte(line))
+			Expect(ok).To(BeFalse(), line)
+		}
+		name, block, ok := parsecovblock([]byte("c:/a b.go:1.0,2.42 3 4294967295"))
+		Expect(ok).To(BeTrue())
+		Expect(string(name)).To(Equal("c:/a b.go"))
+		Expect(block).To(Equal(coverageProfileBlock{
+			StartLine: 1,
+			StartCol:  0,
+			EndLine:   2,
+			EndCol:    42,
+			NumStmts:  3,
+			Counts:    4294967295,
+		}))
+	})
+
 })
+
+// blocksOf returns the sorted blocks of the specified source.
+func blocksOf(source *coverageProfileSource) []coverageProfileBlock {
+	blocks := []coverageProfileBlock{}
+	for cursor := source.cursor(); cursor.next(); {
+		blocks = append(blocks, cursor.block)
+	}
+	return blocks
+}
+
+// writeLargeCoverageProfile writes a coverage profile data file with the
+// specified number of blocks, spread over multiple sources.
+func writeLargeCoverageProfile(path string, blocks int) {
+	f, err := os.Create(path)
+	Expect(err).NotTo(HaveOccurred())
+	w := bufio.NewWriter(f)
+	fmt.Fprintln(w, "mode: atomic")
+	for idx := 0; idx < blocks; idx++ {
+		fmt.Fprintf(w, "github.com/thediveo/gons/some/pkg%d/source.go:%d.%d,%d.%d %d %d\n",
+			idx/1000, idx, idx%80, idx+3, idx%60, idx%5+1, idx%3)
+	}
+	Expect(w.Flush()).To(Succeed())
+	Expect(f.Close()).To(Succeed())
+}
+
+// BenchmarkReadCoverageFile compares the regexp-based coverage profile data
+// file parser we used to have with our current byte-level parser.
+func BenchmarkReadCoverageFile(b *gotesting.B) {
+	path := filepath.Join(b.TempDir(), "large.cov")
+	writeLargeCoverageProfile(path, 100000)
+	for _, bm := range []struct {
+		name  string
+		parse func(string) *coverageProfile
+	}{
+		{name: "regexp", parse: readcovfileRegexp},
+		{name: "bytes", parse: readcovfile},
+	} {
+		b.Run(bm.name, func(b *gotesting.B) {
+			b.ReportAllocs()
+			for n := 0; n < b.N; n++ {
+				bm.parse(path)
+			}
+		})
+	}
+}
+
+// modeRe specifies the format of the first "mode:" text line of a coverage
+// profile data file.
+var modeRe = regexp.MustCompile(`^mode: ([[:alpha:]]+)$`)
+
+// lineRe specifies the format of the block text lines in coverage profile
+// data files.
+var lineRe = regexp.MustCompile(
+	`^(.+):([0-9]+).([0-9]+),([0-9]+).([0-9]+) ([0-9]+) ([0-9]+)$`)
+
+// readcovfileRegexp is the original regexp-based coverage profile data file
+// parser, kept as the reference for readcovfile.
+func readcovfileRegexp(path string) *coverageProfile {
+	cpf, err := os.Open(toOutputDir(path))
+	if err != nil {
+		if os.IsNotExist(err) {
+			return nil
+		}
+		panic(err.Error())
+	}
+	defer cpf.Close()
+	scan := bufio.NewScanner(cpf)
+	if !scan.Scan() {
+		return nil
+	}
+	cp := newCoverageProfile()
+	m := modeRe.FindStringSubmatch(scan.Text())
+	if m == nil {
+		panic(fmt.Sprintf(
+			"line %q doesn't match expected mode: line format", scan.Text()))
+	}
+	cp.Mode = m[1]
+	var srcname string
+	var source *coverageProfileSource
+	for scan.Scan() {
+		m := lineRe.FindStringSubmatch(scan.Text())
+		if m == nil {
+			panic(fmt.Sprintf(
+				"line %q doesn't match expected block line format", scan.Text()))
+		}
+		if m[1] != srcname {
+			srcname = m[1]
+			source = &coverageProfileSource{}
+			cp.Sources[srcname] = source
+		}
+		source.add(coverageProfileBlock{
+			StartLine: toUint32(m[2]),
+			StartCol:  toUint16(m[3]),
+			EndLine:   toUint32(m[4]),
+			EndCol:    toUint16(m[5]),
+			NumStmts:  toUint16(m[6]),
+			Counts:    toUint32(m[7]),
+		})
+	}
+	for _, source := range cp.Sources {
+		source.sortPending(cp.Mode == "set")
+	}
+	return cp
+}
+
+func toUint32(s string) uint32 {
+	v, err := strconv.ParseUint(s, 10, 32)
+	if err != nil {
+		panic(err.Error())
+	}
+	return uint32(v)
+}
+
+func toUint16(s string) uint16 {
+	v, err := strconv.ParseUint(s, 10, 16)
+	if err != nil {
+		panic(err.Error())
+	}
+	return uint16(v)
+}
+
+// mergeCoverageFilesResort is the original merge of coverage profile data
+// files, kept as the reference for the k-way merge of mergeCoverageFiles: for
+// each file, it appends the file's blocks to the blocks merged so far,
+// re-sorts them all by their start positions only, and then merges adjacent
+// blocks of the same location. As blocks starting at the same position thus
+// end up in no particular order, the reference only gives well-defined results
+// for sources without different blocks starting at the same position. It
+// returns the coverage mode and the merged blocks per source.
+func mergeCoverageFilesResort(paths []string) (string, map[string][]coverageProfileBlock) {
+	mode := ""
+	sources := map[string][]coverageProfileBlock{}
+	for _, path := range paths {
+		cp := readcovfile(path)
+		if cp == nil {
+			continue
+		}
+		mode = cp.Mode
+		for srcname, source := range cp.Sources {
+			blocks := sources[srcname]
+			blocks = append(blocks, blocksOf(source)...)
+			sort.Slice(blocks, func(i, j int) bool {
+				bi, bj := &blocks[i], &blocks[j]
+				return bi.StartLine < bj.StartLine ||
+					(bi.StartLine == bj.StartLine && bi.StartCol < bj.StartCol)
+			})
+			merged := blocks[:1]
+			for _, block := range blocks[1:] {
+				last := &merged[len(merged)-1]
+				if last.StartLine == block.StartLine && last.StartCol == block.StartCol &&
+					last.EndLine == block.EndLine && last.EndCol == block.EndCol {
+					if mode == "set" {
+						last.Counts |= block.Counts
+					} else {
+						last.Counts += block.Counts
+					}
+					continue
+				}
+				merged = append(merged, block)
+			}
+			sources[srcname] = merged
+		}
+	}
+	return mode, sources
+}